@@ -1,17 +1,44 @@
 mkdir -p build_sh
 
-g++ -c -o build_sh/Cone.o src/Cone.cpp 
-g++ -c -o build_sh/Cube.o src/Cube.cpp 
-g++ -c -o build_sh/Cylinder.o src/Cylinder.cpp 
-g++ -c -o build_sh/Plane.o src/Plane.cpp 
-g++ -c -o build_sh/Ray.o src/Ray.cpp 
-g++ -c -o build_sh/RayTracer.o src/RayTracer.cpp 
-g++ -c -o build_sh/SceneObject.o src/SceneObject.cpp 
-g++ -c -o build_sh/Sphere.o src/Sphere.cpp 
-g++ -c -o build_sh/Tetrahedron.o src/Tetrahedron.cpp 
-g++ -c -o build_sh/TextureBMP.o src/TextureBMP.cpp 
-g++ -c -o build_sh/Triangle.o src/Triangle.cpp 
+g++ -c -O2 -pthread -o build_sh/AllocationCounter.o src/AllocationCounter.cpp 
+g++ -c -O2 -pthread -o build_sh/BVH.o src/BVH.cpp 
+g++ -c -O2 -pthread -o build_sh/Box.o src/Box.cpp 
+g++ -c -O2 -pthread -o build_sh/Camera.o src/Camera.cpp 
+g++ -c -O2 -pthread -o build_sh/Cone.o src/Cone.cpp 
+g++ -c -O2 -pthread -o build_sh/ConvexPolyhedron.o src/ConvexPolyhedron.cpp 
+g++ -c -O2 -pthread -o build_sh/CpuDispatch.o src/CpuDispatch.cpp 
+g++ -c -O2 -pthread -o build_sh/Cube.o src/Cube.cpp 
+g++ -c -O2 -pthread -o build_sh/Cylinder.o src/Cylinder.cpp 
+g++ -c -O2 -pthread -o build_sh/Deadline.o src/Deadline.cpp 
+g++ -c -O2 -pthread -o build_sh/Distributed.o src/Distributed.cpp 
+g++ -c -O2 -pthread -o build_sh/DynamicResolution.o src/DynamicResolution.cpp 
+g++ -c -O2 -pthread -o build_sh/Framebuffer.o src/Framebuffer.cpp 
+g++ -c -O2 -pthread -o build_sh/Instance.o src/Instance.cpp 
+g++ -c -O2 -pthread -o build_sh/Lighting.o src/Lighting.cpp 
+g++ -c -O2 -pthread -o build_sh/LightingCache.o src/LightingCache.cpp 
+g++ -c -O2 -pthread -o build_sh/Options.o src/Options.cpp 
+g++ -c -O2 -pthread -o build_sh/PPMStream.o src/PPMStream.cpp 
+g++ -c -O2 -pthread -o build_sh/PerfCounters.o src/PerfCounters.cpp 
+g++ -c -O2 -pthread -o build_sh/PhotonMap.o src/PhotonMap.cpp 
+g++ -c -O2 -pthread -o build_sh/Plane.o src/Plane.cpp 
+g++ -c -O2 -pthread -o build_sh/Ray.o src/Ray.cpp 
+g++ -c -O2 -pthread -o build_sh/RayTracer.o src/RayTracer.cpp 
+g++ -c -O2 -pthread -o build_sh/RenderServer.o src/RenderServer.cpp 
+g++ -c -O2 -pthread -o build_sh/RenderThread.o src/RenderThread.cpp 
+g++ -c -O2 -pthread -o build_sh/Sampler.o src/Sampler.cpp 
+g++ -c -O2 -pthread -o build_sh/SceneArena.o src/SceneArena.cpp 
+g++ -c -O2 -pthread -o build_sh/SceneObject.o src/SceneObject.cpp 
+g++ -c -O2 -pthread -o build_sh/SharedFramebuffer.o src/SharedFramebuffer.cpp 
+g++ -c -O2 -pthread -o build_sh/Sphere.o src/Sphere.cpp 
+g++ -c -O2 -pthread -o build_sh/Tetrahedron.o src/Tetrahedron.cpp 
+g++ -c -O2 -pthread -o build_sh/TextureBMP.o src/TextureBMP.cpp 
+g++ -c -O2 -pthread -o build_sh/Tile.o src/Tile.cpp 
+g++ -c -O2 -pthread -o build_sh/TilePool.o src/TilePool.cpp 
+g++ -c -O2 -pthread -o build_sh/Timeline.o src/Timeline.cpp 
+g++ -c -O2 -pthread -o build_sh/Triangle.o src/Triangle.cpp 
+g++ -c -O2 -pthread -o build_sh/Views.o src/Views.cpp 
+g++ -c -O2 -pthread -o build_sh/VisibilityBuffer.o src/VisibilityBuffer.cpp 
 
-g++ -o program.out build_sh/Cone.o build_sh/Cube.o build_sh/Cylinder.o build_sh/Plane.o build_sh/Ray.o build_sh/RayTracer.o build_sh/SceneObject.o build_sh/Sphere.o build_sh/Tetrahedron.o build_sh/TextureBMP.o build_sh/Triangle.o -lm -lGL -lGLU -lglut
+g++ -o program.out build_sh/AllocationCounter.o build_sh/BVH.o build_sh/Box.o build_sh/Camera.o build_sh/Cone.o build_sh/ConvexPolyhedron.o build_sh/CpuDispatch.o build_sh/Cube.o build_sh/Cylinder.o build_sh/Deadline.o build_sh/Distributed.o build_sh/DynamicResolution.o build_sh/Framebuffer.o build_sh/Instance.o build_sh/Lighting.o build_sh/LightingCache.o build_sh/Options.o build_sh/PPMStream.o build_sh/PerfCounters.o build_sh/PhotonMap.o build_sh/Plane.o build_sh/Ray.o build_sh/RayTracer.o build_sh/RenderServer.o build_sh/RenderThread.o build_sh/Sampler.o build_sh/SceneArena.o build_sh/SceneObject.o build_sh/SharedFramebuffer.o build_sh/Sphere.o build_sh/Tetrahedron.o build_sh/TextureBMP.o build_sh/Tile.o build_sh/TilePool.o build_sh/Timeline.o build_sh/Triangle.o build_sh/Views.o build_sh/VisibilityBuffer.o -lm -lGL -lGLU -lglut -lrt
 
 ./program.out
\ No newline at end of file
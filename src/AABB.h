@@ -0,0 +1,88 @@
+#ifndef H_AABB
+#define H_AABB
+
+#include <glm/glm.hpp>
+#include <math.h>
+
+/**
+ * @brief An axis-aligned bounding box. A default constructed box is empty, and
+ * grows to fit whatever is added to it.
+ *
+ */
+struct AABB {
+  glm::vec3 lo;
+  glm::vec3 hi;
+
+  AABB() : lo(glm::vec3(INFINITY)), hi(glm::vec3(-INFINITY)) {}
+
+  AABB(glm::vec3 l, glm::vec3 h) : lo(l), hi(h) {}
+
+  void expand(glm::vec3 p) {
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+
+  void expand(const AABB &box) {
+    lo = glm::min(lo, box.lo);
+    hi = glm::max(hi, box.hi);
+  }
+
+  /**
+   * @brief Grows the box by `margin` on every side, so that points which lie
+   * exactly on an object's surface are never culled by rounding errors.
+   *
+   */
+  void pad(float margin) {
+    lo -= glm::vec3(margin);
+    hi += glm::vec3(margin);
+  }
+
+  glm::vec3 center() const { return (lo + hi) * 0.5f; }
+
+  /**
+   * @brief The surface area of the box, which is proportional to the chance
+   * that a random ray passes through it.
+   *
+   */
+  float area() const {
+    glm::vec3 d = hi - lo;
+    return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+  }
+
+  /**
+   * @brief Checks whether a ray enters the box before `tmax` (slab test).
+   *
+   * @param pos The source point of the ray.
+   * @param invDir 1 / the ray's direction, per component.
+   * @param tmax The furthest distance of interest along the ray.
+   * @return true The ray passes through the box within [0, tmax].
+   * @return false The ray misses the box, or only reaches it after `tmax`.
+   */
+  bool hit(glm::vec3 pos, glm::vec3 invDir, float tmax) const {
+    float tnear = 0;
+    float tfar = tmax;
+    for (int axis = 0; axis < 3; axis++) {
+      float t1 = (lo[axis] - pos[axis]) * invDir[axis];
+      float t2 = (hi[axis] - pos[axis]) * invDir[axis];
+      // NaN (0 * infinity) happens when the ray lies in the slab's plane, and
+      // is treated as not limiting the interval
+      if (t1 > t2) {
+        float temp = t1;
+        t1 = t2;
+        t2 = temp;
+      }
+      if (t1 > tnear) {
+        tnear = t1;
+      }
+      if (t2 < tfar) {
+        tfar = t2;
+      }
+      if (tnear > tfar) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+#endif //! H_AABB
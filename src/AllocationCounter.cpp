@@ -0,0 +1,28 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+// Replacing the global operator new counts every allocation in the program,
+// including those made inside the standard library. The array and nothrow
+// forms call this one by default, so they are counted as well.
+static std::atomic<size_t> allocationCount(0);
+
+void *operator new(size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  void *memory = malloc(size == 0 ? 1 : size);
+  if (memory == NULL) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void *memory) noexcept { free(memory); }
+
+// Called instead of the unsized form when the size is known, so it must free
+// the memory from `malloc` too
+void operator delete(void *memory, size_t) noexcept { free(memory); }
+
+size_t heapAllocations() {
+  return allocationCount.load(std::memory_order_relaxed);
+}
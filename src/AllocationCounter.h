@@ -0,0 +1,15 @@
+#ifndef H_ALLOCATION_COUNTER
+#define H_ALLOCATION_COUNTER
+
+#include <stddef.h>
+
+/**
+ * @brief Returns the number of heap allocations made through `operator new`
+ * since the program started. Comparing the count before and after a frame
+ * shows whether tracing allocates.
+ *
+ * @return size_t
+ */
+size_t heapAllocations();
+
+#endif //! H_ALLOCATION_COUNTER
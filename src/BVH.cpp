@@ -0,0 +1,258 @@
+#include "BVH.h"
+#include <algorithm>
+
+using namespace std;
+
+// The most objects kept in a leaf
+const int LEAF_SIZE = 2;
+
+// How far boxes are grown past their objects, so that hits on an object's
+// surface are never lost to rounding
+const float BOX_MARGIN = 1e-3;
+
+// How much a node's box may grow past its area when it was built before its
+// subtree is rebuilt
+const float REBUILD_GROWTH = 2;
+
+/**
+ * @brief The number of nodes in a subtree over `count` objects. It depends
+ * only on the count, so a subtree can be rebuilt in place.
+ *
+ * @param count
+ * @return int
+ */
+static int nodesFor(int count) {
+  if (count <= LEAF_SIZE) {
+    return 1;
+  }
+  return 1 + nodesFor(count / 2) + nodesFor(count - count / 2);
+}
+
+/**
+ * @brief Builds the tree over `objects`, replacing any previous tree.
+ *
+ * @param objects
+ */
+void BVH::build(const vector<SceneObject *> &objects) {
+  nodes.clear();
+  order.clear();
+  boxes.resize(objects.size());
+  leaves.resize(objects.size());
+  if (objects.empty()) {
+    return;
+  }
+
+  for (size_t i = 0; i < objects.size(); i++) {
+    boxes[i] = objects[i]->bounds();
+    boxes[i].pad(BOX_MARGIN);
+    order.push_back(i);
+  }
+  int count = nodesFor(order.size());
+  nodes.resize(count);
+  parents.resize(count);
+  builtArea.resize(count);
+  buildNode(0, order.size(), 0, -1);
+}
+
+/**
+ * @brief Builds the subtree over `order[begin, end)` at `nodes[index]`, by
+ * splitting the objects in half along the longest axis of their centers.
+ * The subtree takes up `nodesFor(end - begin)` nodes from `index`, with the
+ * left subtree straight after its root and the right subtree after that.
+ *
+ * @param begin
+ * @param end
+ * @param index Where the subtree's root is stored.
+ * @param parent The root's parent, or -1.
+ */
+void BVH::buildNode(int begin, int end, int index, int parent) {
+  AABB box, centers;
+  for (int i = begin; i < end; i++) {
+    box.expand(boxes[order[i]]);
+    centers.expand(boxes[order[i]].center());
+  }
+  nodes[index].box = box;
+  parents[index] = parent;
+  builtArea[index] = box.area();
+
+  if (end - begin <= LEAF_SIZE) {
+    nodes[index].first = begin;
+    nodes[index].count = end - begin;
+    nodes[index].axis = 0;
+    for (int i = begin; i < end; i++) {
+      leaves[order[i]] = index;
+    }
+    return;
+  }
+
+  glm::vec3 extent = centers.hi - centers.lo;
+  int axis = 0;
+  if (extent.y > extent[axis]) {
+    axis = 1;
+  }
+  if (extent.z > extent[axis]) {
+    axis = 2;
+  }
+
+  int middle = (begin + end) / 2;
+  nth_element(order.begin() + begin, order.begin() + middle,
+              order.begin() + end, [&](int a, int b) {
+                return boxes[a].center()[axis] < boxes[b].center()[axis];
+              });
+
+  int right = index + 1 + nodesFor(middle - begin);
+  buildNode(begin, middle, index + 1, index);
+  buildNode(middle, end, right, index);
+  nodes[index].first = right;
+  nodes[index].count = 0;
+  nodes[index].axis = axis;
+}
+
+/**
+ * @brief Recomputes a node's box from its objects or its children.
+ *
+ * @param index
+ */
+void BVH::refitNode(int index) {
+  Node &node = nodes[index];
+  AABB box;
+  if (node.count > 0) {
+    for (int k = node.first; k < node.first + node.count; k++) {
+      box.expand(boxes[order[k]]);
+    }
+  } else {
+    box.expand(nodes[index + 1].box);
+    box.expand(nodes[node.first].box);
+  }
+  node.box = box;
+}
+
+/**
+ * @brief Updates the tree after some objects have moved. The boxes on the
+ * path from each moved object's leaf to the root are recomputed, so the work
+ * grows with the number of moved objects rather than the size of the scene.
+ *
+ * Refitting keeps the tree's structure, which gets worse as objects move away
+ * from where it was built. Any subtree whose box has grown to more than
+ * `REBUILD_GROWTH` times its area when built is rebuilt from its objects'
+ * current boxes.
+ *
+ * @param objects The list the tree was built over.
+ * @param moved The indices of the objects which have moved.
+ * @return RefitStats
+ */
+RefitStats BVH::refit(const vector<SceneObject *> &objects,
+                      const vector<int> &moved) {
+  RefitStats stats = {0, 0, 0};
+  vector<int> degraded;
+  for (size_t m = 0; m < moved.size(); m++) {
+    int i = moved[m];
+    boxes[i] = objects[i]->bounds();
+    boxes[i].pad(BOX_MARGIN);
+
+    int loosest = -1;
+    for (int n = leaves[i]; n != -1; n = parents[n]) {
+      refitNode(n);
+      stats.nodesRefitted++;
+      if (nodes[n].box.area() > REBUILD_GROWTH * builtArea[n]) {
+        loosest = n;
+      }
+    }
+    if (loosest != -1) {
+      degraded.push_back(loosest);
+    }
+  }
+
+  // A subtree's nodes follow its root, so sorting puts every subtree before
+  // the subtrees inside it, which are then rebuilt along with it
+  sort(degraded.begin(), degraded.end());
+  int rebuiltEnd = 0;
+  for (size_t d = 0; d < degraded.size(); d++) {
+    int index = degraded[d];
+    if (index < rebuiltEnd) {
+      continue;
+    }
+
+    // The subtree's objects are those from its leftmost leaf to its rightmost
+    int first = index;
+    while (nodes[first].count == 0) {
+      first++;
+    }
+    int last = index;
+    while (nodes[last].count == 0) {
+      last = nodes[last].first;
+    }
+    int begin = nodes[first].first;
+    int end = nodes[last].first + nodes[last].count;
+
+    buildNode(begin, end, index, parents[index]);
+    rebuiltEnd = index + nodesFor(end - begin);
+    stats.subtreesRebuilt++;
+    stats.objectsRebuilt += end - begin;
+  }
+  return stats;
+}
+
+/**
+ * @brief Finds the closest intersection of a ray with the objects the tree was
+ * built over. Subtrees are skipped when the ray misses their box, or only
+ * reaches it beyond the closest hit found so far.
+ *
+ * @param ray
+ * @param objects The list the tree was built over.
+ * @return Hit
+ */
+Hit BVH::closestHit(const Ray &ray,
+                    const vector<SceneObject *> &objects) const {
+  Hit hit;
+  hit.t = ray.tmax;
+  if (nodes.empty()) {
+    return hit;
+  }
+
+  glm::vec3 invDir = 1.0f / ray.dir;
+  int stack[64];
+  int depth = 0;
+  stack[depth++] = 0;
+
+  while (depth > 0) {
+    const Node &node = nodes[stack[--depth]];
+    if (!node.box.hit(ray.pt, invDir, hit.t)) {
+      continue;
+    }
+
+    if (node.count == 0) {
+      // Visit the child nearer the ray's source first, as it is more likely to
+      // hold the closest hit
+      int left = &node - &nodes[0] + 1;
+      if (ray.dir[node.axis] < 0) {
+        stack[depth++] = left;
+        stack[depth++] = node.first;
+      } else {
+        stack[depth++] = node.first;
+        stack[depth++] = left;
+      }
+      continue;
+    }
+
+    for (int k = node.first; k < node.first + node.count; k++) {
+      int i = order[k];
+      int part;
+      float t = objects[i]->intersectPart(ray.pt, ray.dir, &part);
+      if (t > ray.tmin &&
+          (t < hit.t || (t == hit.t && hit.index != -1 && i < hit.index))) {
+        hit.t = t;
+        hit.index = i;
+        hit.part = part;
+      }
+    }
+  }
+  return hit;
+}
+
+/**
+ * @brief Returns the box enclosing every object in the tree.
+ *
+ * @return AABB
+ */
+AABB BVH::bounds() const { return nodes.empty() ? AABB() : nodes[0].box; }
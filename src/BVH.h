@@ -0,0 +1,72 @@
+#ifndef H_BVH
+#define H_BVH
+
+#include "AABB.h"
+#include "Ray.h"
+#include "SceneObject.h"
+#include <vector>
+
+/**
+ * @brief What `BVH::refit` did to keep the tree up to date.
+ *
+ */
+struct RefitStats {
+  int nodesRefitted;   // Nodes whose boxes were recomputed
+  int subtreesRebuilt; // Subtrees which had grown too loose, and were rebuilt
+  int objectsRebuilt;  // Objects in the rebuilt subtrees
+};
+
+/**
+ * @brief A bounding volume hierarchy over a list of objects. The objects are
+ * not owned, and the list must not change between `build()` and the searches
+ * that use it. Objects may move, as long as the tree is refitted before it is
+ * searched again.
+ *
+ * Searches return exactly what a linear search over the list would: when two
+ * objects are hit at the same distance, the one earlier in the list wins.
+ *
+ */
+class BVH {
+private:
+  /**
+   * @brief A node of the tree. Leaves hold `count` objects from `order`,
+   * starting at `first`. Other nodes have their left child straight after
+   * them, and their right child at `first`.
+   *
+   */
+  struct Node {
+    AABB box;
+    int first;
+    int count;
+    int axis; // The axis the children are split along
+  };
+
+  std::vector<Node> nodes;
+  std::vector<int> order;
+
+  // Kept so that moved objects can be refitted without visiting the rest of
+  // the tree
+  std::vector<AABB> boxes;      // The padded box of each object
+  std::vector<int> parents;     // The parent of each node, or -1 for the root
+  std::vector<int> leaves;      // The leaf holding each object
+  std::vector<float> builtArea; // The area of each node's box when built
+
+  void buildNode(int begin, int end, int index, int parent);
+
+  void refitNode(int index);
+
+public:
+  void build(const std::vector<SceneObject *> &objects);
+
+  RefitStats refit(const std::vector<SceneObject *> &objects,
+                   const std::vector<int> &moved);
+
+  Hit closestHit(const Ray &ray,
+                 const std::vector<SceneObject *> &objects) const;
+
+  AABB bounds() const;
+
+  size_t nodeCount() const { return nodes.size(); }
+};
+
+#endif //! H_BVH
@@ -0,0 +1,107 @@
+#include "Box.h"
+#include "Ray.h"
+#include <math.h>
+
+/**
+ * @brief Finds where a ray enters the box, or where it leaves the box if it
+ * starts inside.
+ *
+ * @param posn The source point of the ray.
+ * @param dir The direction of the ray.
+ * @param part Receives the face that was hit.
+ * @return float The distance to the hit, or -1 for no hit.
+ */
+float Box::intersectPart(glm::vec3 posn, glm::vec3 dir, int *part) {
+  float tnear = -INFINITY;
+  float tfar = INFINITY;
+  int nearFace = 0;
+  int farFace = 0;
+
+  for (int axis = 0; axis < 3; axis++) {
+    if (dir[axis] == 0) {
+      // Parallel to this slab, so the ray is always inside it or never
+      if (posn[axis] < lo[axis] || posn[axis] > hi[axis]) {
+        return -1;
+      }
+      continue;
+    }
+
+    float t1 = (lo[axis] - posn[axis]) / dir[axis];
+    float t2 = (hi[axis] - posn[axis]) / dir[axis];
+    int face1 = 2 * axis;
+    int face2 = 2 * axis + 1;
+    if (t1 > t2) {
+      float t = t1;
+      t1 = t2;
+      t2 = t;
+      face1 = face2;
+      face2 = 2 * axis;
+    }
+
+    if (t1 > tnear) {
+      tnear = t1;
+      nearFace = face1;
+    }
+    if (t2 < tfar) {
+      tfar = t2;
+      farFace = face2;
+    }
+  }
+
+  if (tnear > tfar) {
+    return -1;
+  }
+  if (tnear >= MIN_HIT_DISTANCE) {
+    *part = nearFace;
+    return tnear;
+  }
+  if (tfar >= MIN_HIT_DISTANCE) {
+    *part = farFace;
+    return tfar;
+  }
+  return -1;
+}
+
+float Box::intersect(glm::vec3 posn, glm::vec3 dir) {
+  int part;
+  return intersectPart(posn, dir, &part);
+}
+
+/**
+ * @brief Returns the outward unit normal of a face, which is the same at every
+ * point of the face.
+ *
+ * @param part The face, from `intersectPart`.
+ * @return glm::vec3
+ */
+glm::vec3 Box::normalOfPart(glm::vec3, int part) {
+  glm::vec3 n(0);
+  n[part / 2] = part % 2 == 0 ? -1 : 1;
+  return n;
+}
+
+/**
+ * @brief Returns the normal of the face closest to a point on the surface.
+ *
+ * @param p
+ * @return glm::vec3
+ */
+glm::vec3 Box::normal(glm::vec3 p) {
+  int closest = 0;
+  float closestDistance = INFINITY;
+  for (int axis = 0; axis < 3; axis++) {
+    float toLo = fabs(p[axis] - lo[axis]);
+    float toHi = fabs(p[axis] - hi[axis]);
+    if (toLo < closestDistance) {
+      closestDistance = toLo;
+      closest = 2 * axis;
+    }
+    if (toHi < closestDistance) {
+      closestDistance = toHi;
+      closest = 2 * axis + 1;
+    }
+  }
+  return normalOfPart(p, closest);
+}
+
+AABB Box::bounds() { return AABB(lo, hi); }
@@ -0,0 +1,39 @@
+#ifndef H_BOX
+#define H_BOX
+
+#include "SceneObject.h"
+#include <glm/glm.hpp>
+
+/**
+ * @brief Defines an axis-aligned box as a subclass of `SceneObject`. A box is
+ * intersected with one slab test, which also finds the face that was hit.
+ * Boxes with other orientations can be made by instancing a box.
+ *
+ * The faces are numbered `2 * axis` for the face at `lo[axis]`, and
+ * `2 * axis + 1` for the face at `hi[axis]`.
+ *
+ */
+class Box : public SceneObject {
+private:
+  glm::vec3 lo;
+  glm::vec3 hi;
+
+public:
+  Box() : lo(glm::vec3(-0.5)), hi(glm::vec3(0.5)) { color = glm::vec3(1); }
+
+  Box(glm::vec3 l, glm::vec3 h, glm::vec3 col) : lo(l), hi(h) {
+    color = col;
+  }
+
+  float intersect(glm::vec3 posn, glm::vec3 dir);
+
+  float intersectPart(glm::vec3 posn, glm::vec3 dir, int *part);
+
+  glm::vec3 normal(glm::vec3 p);
+
+  glm::vec3 normalOfPart(glm::vec3 p, int part);
+
+  AABB bounds();
+};
+
+#endif //! H_BOX
@@ -0,0 +1,117 @@
+#include "Camera.h"
+#include <math.h>
+
+// Stops the camera from flipping over when looking straight up or down
+const float MAX_PITCH = 1.5;
+
+// Below this, the forward vector is taken to be vertical
+const float MIN_HORIZONTAL = 1e-6f;
+
+/**
+ * @brief Recomputes the camera's orthonormal basis from its yaw and pitch.
+ *
+ */
+void Camera::updateBasis() {
+  forward = glm::vec3(sinf(yaw) * cosf(pitch), sinf(pitch),
+                      -cosf(yaw) * cosf(pitch));
+  glm::vec3 horizontal = glm::cross(forward, glm::vec3(0, 1, 0));
+  if (glm::length(horizontal) > MIN_HORIZONTAL) {
+    right = glm::normalize(horizontal);
+  } else {
+    // Looking straight up or down, right follows the yaw alone
+    right = glm::vec3(cosf(yaw), 0, sinf(yaw));
+  }
+  up = glm::cross(right, forward);
+}
+
+/**
+ * @brief Returns the (non-normalized) direction of the primary ray through the
+ * point (x, y) on the image plane.
+ *
+ * @param x x-coordinate on the image plane, in [xmin(), xmax()].
+ * @param y y-coordinate on the image plane, in [ymin(), ymax()].
+ * @return glm::vec3
+ */
+glm::vec3 Camera::direction(float x, float y) const {
+  return right * x + up * y + forward * edist;
+}
+
+/**
+ * @brief Finds where the line from the eye to a point crosses the image plane.
+ * This is the inverse of `direction`.
+ *
+ * @param p The point, in world space.
+ * @param x Receives the x-coordinate on the image plane.
+ * @param y Receives the y-coordinate on the image plane.
+ * @return true The point is in front of the eye.
+ * @return false The point is level with or behind the eye, and has no
+ * projection.
+ */
+bool Camera::project(glm::vec3 p, float *x, float *y) const {
+  glm::vec3 v = p - eye;
+  float depth = glm::dot(v, forward);
+  if (depth <= 0) {
+    return false;
+  }
+  *x = edist * glm::dot(v, right) / depth;
+  *y = edist * glm::dot(v, up) / depth;
+  return true;
+}
+
+/**
+ * @brief Checks whether two cameras create the same primary rays.
+ *
+ * @param other
+ * @return true
+ * @return false
+ */
+bool Camera::sameView(const Camera &other) const {
+  return eye == other.eye && yaw == other.yaw && pitch == other.pitch &&
+         width == other.width && height == other.height &&
+         edist == other.edist;
+}
+
+/**
+ * @brief Moves the eye relative to the direction the camera is facing. Forward
+ * movement stays parallel to the floor, so looking up or down does not make
+ * the camera fly.
+ *
+ * @param dForward Distance to move forwards (negative moves backwards).
+ * @param dRight Distance to move right (negative moves left).
+ * @param dUp Distance to move up (negative moves down).
+ */
+void Camera::move(float dForward, float dRight, float dUp) {
+  glm::vec3 flatForward = glm::vec3(sinf(yaw), 0, -cosf(yaw));
+  eye += flatForward * dForward + right * dRight + glm::vec3(0, dUp, 0);
+}
+
+/**
+ * @brief Rotates the camera.
+ *
+ * @param dYaw Change in yaw, in radians.
+ * @param dPitch Change in pitch, in radians.
+ */
+void Camera::rotate(float dYaw, float dPitch) {
+  yaw += dYaw;
+  pitch += dPitch;
+  if (pitch > MAX_PITCH) {
+    pitch = MAX_PITCH;
+  } else if (pitch < -MAX_PITCH) {
+    pitch = -MAX_PITCH;
+  }
+  updateBasis();
+}
+
+/**
+ * @brief Points the camera in the given direction. Unlike `rotate`, the pitch
+ * is not limited, so the camera may look straight up or down, as the faces of
+ * a cubemap do.
+ *
+ * @param newYaw Rotation about the world y-axis, in radians.
+ * @param newPitch Rotation above or below the horizon, in radians.
+ */
+void Camera::orient(float newYaw, float newPitch) {
+  yaw = newYaw;
+  pitch = newPitch;
+  updateBasis();
+}
@@ -0,0 +1,69 @@
+#ifndef H_CAMERA
+#define H_CAMERA
+
+#include <glm/glm.hpp>
+
+/**
+ * @brief A movable pinhole camera. The image plane is `edist` units in front
+ * of the eye, and spans `width` x `height` world units. With the default
+ * orientation (zero yaw and pitch), the camera looks down the negative z-axis,
+ * which matches the original fixed camera at the origin.
+ *
+ */
+class Camera {
+private:
+  glm::vec3 forward;
+  glm::vec3 right;
+  glm::vec3 up;
+
+  void updateBasis();
+
+public:
+  glm::vec3 eye;
+
+  /**
+   * @brief Rotation about the world y-axis, in radians.
+   *
+   */
+  float yaw;
+
+  /**
+   * @brief Rotation above or below the horizon, in radians.
+   *
+   */
+  float pitch;
+
+  float width;
+  float height;
+  float edist;
+
+  Camera()
+      : eye(glm::vec3(0)), yaw(0), pitch(0), width(20), height(20),
+        edist(40) {
+    updateBasis();
+  }
+
+  Camera(glm::vec3 e, float w, float h, float d)
+      : eye(e), yaw(0), pitch(0), width(w), height(h), edist(d) {
+    updateBasis();
+  }
+
+  float xmin() const { return -width * 0.5f; }
+  float xmax() const { return width * 0.5f; }
+  float ymin() const { return -height * 0.5f; }
+  float ymax() const { return height * 0.5f; }
+
+  glm::vec3 direction(float x, float y) const;
+
+  bool project(glm::vec3 p, float *x, float *y) const;
+
+  bool sameView(const Camera &other) const;
+
+  void move(float dForward, float dRight, float dUp);
+
+  void rotate(float dYaw, float dPitch);
+
+  void orient(float newYaw, float newPitch);
+};
+
+#endif //! H_CAMERA
@@ -67,3 +67,13 @@ glm::vec3 Cone::normal(glm::vec3 posn) {
 
   return glm::normalize(n);
 }
+
+/**
+ * @brief Returns the box enclosing the cone, from its base to its tip.
+ *
+ * @return AABB
+ */
+AABB Cone::bounds() {
+  return AABB(center - glm::vec3(radius, 0, radius),
+              center + glm::vec3(radius, height, radius));
+}
@@ -30,6 +30,8 @@ public:
   float intersect(glm::vec3 posn, glm::vec3 dir);
 
   glm::vec3 normal(glm::vec3 p);
+
+  AABB bounds();
 };
 
 #endif //! H_CONE
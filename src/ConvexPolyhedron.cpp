@@ -0,0 +1,124 @@
+#include "ConvexPolyhedron.h"
+#include "Ray.h"
+#include <math.h>
+
+/**
+ * @brief Adds a face through three of the polyhedron's vertices, which are
+ * counter-clockwise when seen from outside (the same order as a `Triangle`
+ * facing outwards).
+ *
+ * @param a
+ * @param b
+ * @param c
+ * @return true The face was added.
+ * @return false The polyhedron already has `MAX_FACES` faces.
+ */
+bool ConvexPolyhedron::addFace(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+  if (faceCount == MAX_FACES) {
+    return false;
+  }
+  glm::vec3 n = glm::normalize(glm::cross(b - a, c - a));
+  normals[faceCount] = n;
+  offsets[faceCount] = glm::dot(n, a);
+  faceCount++;
+
+  box.expand(a);
+  box.expand(b);
+  box.expand(c);
+  return true;
+}
+
+/**
+ * @brief Finds where a ray enters the polyhedron, or where it leaves the
+ * polyhedron if it starts inside, by clipping the ray against each face's
+ * plane.
+ *
+ * @param posn The source point of the ray.
+ * @param dir The direction of the ray.
+ * @param part Receives the face that was hit.
+ * @return float The distance to the hit, or -1 for no hit.
+ */
+float ConvexPolyhedron::intersectPart(glm::vec3 posn, glm::vec3 dir,
+                                      int *part) {
+  float tnear = -INFINITY;
+  float tfar = INFINITY;
+  int nearFace = 0;
+  int farFace = 0;
+
+  for (int f = 0; f < faceCount; f++) {
+    float approach = glm::dot(normals[f], dir);
+    // Positive outside the face's plane
+    float distance = glm::dot(normals[f], posn) - offsets[f];
+
+    if (approach == 0) {
+      // Parallel to the plane, so the ray is always inside it or never
+      if (distance > 0) {
+        return -1;
+      }
+      continue;
+    }
+
+    float t = -distance / approach;
+    if (approach < 0) {
+      // Entering through this face
+      if (t > tnear) {
+        tnear = t;
+        nearFace = f;
+      }
+    } else if (t < tfar) {
+      tfar = t;
+      farFace = f;
+    }
+    if (tnear > tfar) {
+      return -1;
+    }
+  }
+
+  if (tnear >= MIN_HIT_DISTANCE) {
+    *part = nearFace;
+    return tnear;
+  }
+  if (tfar >= MIN_HIT_DISTANCE) {
+    *part = farFace;
+    return tfar;
+  }
+  return -1;
+}
+
+float ConvexPolyhedron::intersect(glm::vec3 posn, glm::vec3 dir) {
+  int part;
+  return intersectPart(posn, dir, &part);
+}
+
+/**
+ * @brief Returns the outward unit normal of a face, which is the same at every
+ * point of the face.
+ *
+ * @param part The face, from `intersectPart`.
+ * @return glm::vec3
+ */
+glm::vec3 ConvexPolyhedron::normalOfPart(glm::vec3, int part) {
+  return normals[part];
+}
+
+/**
+ * @brief Returns the normal of the face whose plane is closest to a point on
+ * the surface.
+ *
+ * @param p
+ * @return glm::vec3
+ */
+glm::vec3 ConvexPolyhedron::normal(glm::vec3 p) {
+  int closest = 0;
+  float closestDistance = INFINITY;
+  for (int f = 0; f < faceCount; f++) {
+    float distance = fabs(glm::dot(normals[f], p) - offsets[f]);
+    if (distance < closestDistance) {
+      closestDistance = distance;
+      closest = f;
+    }
+  }
+  return normals[closest];
+}
+
+AABB ConvexPolyhedron::bounds() { return box; }
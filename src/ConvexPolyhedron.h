@@ -0,0 +1,42 @@
+#ifndef H_CONVEX_POLYHEDRON
+#define H_CONVEX_POLYHEDRON
+
+#include "SceneObject.h"
+#include <glm/glm.hpp>
+
+/**
+ * @brief Defines a convex polyhedron as a subclass of `SceneObject`, as the
+ * space inside all of its faces' planes. A ray is clipped against every plane
+ * in one pass, which finds both the hit and the face that was hit.
+ *
+ */
+class ConvexPolyhedron : public SceneObject {
+public:
+  // The most faces a polyhedron can have
+  static const int MAX_FACES = 8;
+
+private:
+  glm::vec3 normals[MAX_FACES]; // The outward unit normal of each face
+  float offsets[MAX_FACES]; // dot(normal, p) for points p on each face
+  int faceCount;
+  AABB box;
+
+public:
+  ConvexPolyhedron() : faceCount(0) { color = glm::vec3(1); }
+
+  ConvexPolyhedron(glm::vec3 col) : faceCount(0) { color = col; }
+
+  bool addFace(glm::vec3 a, glm::vec3 b, glm::vec3 c);
+
+  float intersect(glm::vec3 posn, glm::vec3 dir);
+
+  float intersectPart(glm::vec3 posn, glm::vec3 dir, int *part);
+
+  glm::vec3 normal(glm::vec3 p);
+
+  glm::vec3 normalOfPart(glm::vec3 p, int part);
+
+  AABB bounds();
+};
+
+#endif //! H_CONVEX_POLYHEDRON
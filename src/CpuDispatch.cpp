@@ -0,0 +1,53 @@
+#include "CpuDispatch.h"
+#include <string.h>
+
+// The names of the levels, as given on the command line
+static const char *const ISA_NAMES[] = {"generic", "sse4", "avx2", "avx512"};
+
+/**
+ * @brief Finds the best level that the processor, and the operating system,
+ * supports.
+ *
+ * @return IsaLevel
+ */
+IsaLevel detectIsa() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return ISA_AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return ISA_AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return ISA_SSE4;
+  }
+#endif
+  return ISA_GENERIC;
+}
+
+/**
+ * @brief Gets the name of a level, as given on the command line.
+ *
+ * @param level
+ * @return const char*
+ */
+const char *isaName(IsaLevel level) { return ISA_NAMES[level]; }
+
+/**
+ * @brief Parses the name of a level.
+ *
+ * @param name
+ * @param level Receives the level.
+ * @return true The name is known.
+ * @return false The name is not known.
+ */
+bool parseIsa(const char *name, IsaLevel *level) {
+  for (int i = ISA_GENERIC; i <= ISA_AVX512; i++) {
+    if (strcmp(name, ISA_NAMES[i]) == 0) {
+      *level = (IsaLevel)i;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,18 @@
+#ifndef H_CPU_DISPATCH
+#define H_CPU_DISPATCH
+
+/**
+ * @brief The instruction sets the hot kernels are compiled for. Each level
+ * includes the ones before it, and `ISA_GENERIC` runs on any x86-64 processor
+ * (or any processor at all, on other architectures).
+ *
+ */
+enum IsaLevel { ISA_GENERIC, ISA_SSE4, ISA_AVX2, ISA_AVX512 };
+
+IsaLevel detectIsa();
+
+const char *isaName(IsaLevel level);
+
+bool parseIsa(const char *name, IsaLevel *level);
+
+#endif //! H_CPU_DISPATCH
@@ -1,4 +1,5 @@
 #include "Cube.h"
+#include "Box.h"
 #include "Plane.h"
 
 using namespace std;
@@ -30,7 +31,7 @@ using namespace std;
 /**
  * @brief Draws a cube, with the center being at (x, y, z), with the given
  * width, length, height, and color. The cube is pushed onto the given scene
- * objects vector.
+ * objects vector, either as one `Box` or as six `Plane` faces.
  *
  * @param x x-coordinate of the center of the cube.
  * @param y y-coordinate of the center of the cube.
@@ -39,16 +40,27 @@ using namespace std;
  * @param width The width of the cube (y-direction).
  * @param height The height of the cube (z-direction).
  * @param color The color of the cube to draw.
+ * @param arena The arena the faces are created in.
  * @param sceneObjects The vector of scene objects the cube should be pushed
  * onto.
+ * @param solid Whether the cube is a single `Box`, which is intersected with
+ * one slab test, rather than six faces tested separately.
  */
 void drawCube(float x, float y, float z, float length, float width,
-              float height, glm::vec3 color,
-              vector<SceneObject *> *sceneObjects) {
+              float height, glm::vec3 color, SceneArena *arena,
+              vector<SceneObject *> *sceneObjects, bool solid) {
   float halfLength = length / 2;
   float halfWidth = width / 2;
   float halfHeight = height / 2;
 
+  if (solid) {
+    glm::vec3 half = glm::vec3(halfLength, halfWidth, halfHeight);
+    glm::vec3 center = glm::vec3(x, y, z);
+    Box *box = arena->create<Box>(center - half, center + half, color);
+    sceneObjects->push_back(box);
+    return;
+  }
+
   glm::vec3 A = glm::vec3(x + halfLength, y - halfWidth, z - halfHeight);
   glm::vec3 B = glm::vec3(x + halfLength, y + halfWidth, z - halfHeight);
 
@@ -61,18 +73,18 @@ void drawCube(float x, float y, float z, float length, float width,
   glm::vec3 G = glm::vec3(x - halfLength, y + halfWidth, z + halfHeight);
   glm::vec3 H = glm::vec3(x - halfLength, y - halfWidth, z + halfHeight);
 
-  Plane *front = new Plane(A, B, C, D, color);
+  Plane *front = arena->create<Plane>(A, B, C, D, color);
   sceneObjects->push_back(front);
-  Plane *back = new Plane(E, F, G, H, color);
+  Plane *back = arena->create<Plane>(E, F, G, H, color);
   sceneObjects->push_back(back);
 
-  Plane *left = new Plane(A, D, H, E, color);
+  Plane *left = arena->create<Plane>(A, D, H, E, color);
   sceneObjects->push_back(left);
-  Plane *right = new Plane(B, F, G, C, color);
+  Plane *right = arena->create<Plane>(B, F, G, C, color);
   sceneObjects->push_back(right);
 
-  Plane *top = new Plane(D, C, G, H, color);
+  Plane *top = arena->create<Plane>(D, C, G, H, color);
   sceneObjects->push_back(top);
-  Plane *bottom = new Plane(A, E, F, B, color);
+  Plane *bottom = arena->create<Plane>(A, E, F, B, color);
   sceneObjects->push_back(bottom);
 }
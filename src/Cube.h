@@ -1,3 +1,4 @@
+#include "SceneArena.h"
 #include "SceneObject.h"
 #include <glm/glm.hpp>
 #include <vector>
@@ -5,5 +6,5 @@
 using namespace std;
 
 void drawCube(float x, float y, float z, float length, float width,
-              float height, glm::vec3 color,
-              vector<SceneObject *> *sceneObjects);
+              float height, glm::vec3 color, SceneArena *arena,
+              vector<SceneObject *> *sceneObjects, bool solid = true);
@@ -61,3 +61,13 @@ glm::vec3 Cylinder::normal(glm::vec3 posn) {
   float z = d.z / radius;
   return glm::vec3(x, y, z);
 }
+
+/**
+ * @brief Returns the box enclosing the cylinder, from its base to its top.
+ *
+ * @return AABB
+ */
+AABB Cylinder::bounds() {
+  return AABB(center - glm::vec3(radius, 0, radius),
+              center + glm::vec3(radius, height, radius));
+}
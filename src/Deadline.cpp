@@ -0,0 +1,195 @@
+#include "Deadline.h"
+#include <algorithm>
+
+using namespace std;
+
+// The fraction of the time left that the remaining tiles are planned to use,
+// which leaves room for tiles that take longer than predicted
+const float PLANNED_FRACTION = 0.9f;
+
+// The level of recursion of the lowest quality level, if allowed
+const int MIN_DEPTH = 2;
+
+/**
+ * @brief Creates a planner whose levels range from one sample per cell, with
+ * little recursion and hard shadows, up to the given full quality.
+ *
+ * @param fullSamples The samples per cell of the highest level.
+ * @param fullDepth The most levels of recursion of the highest level.
+ * @param softShadows Whether the highest level traces soft shadows.
+ */
+DeadlinePlanner::DeadlinePlanner(int fullSamples, int fullDepth,
+                                 bool softShadows)
+    : next(0), level(-1), share(0), primaryRays(0) {
+  QualityLevel lowest = {1, min(MIN_DEPTH, fullDepth), false};
+  levels.push_back(lowest);
+  if (fullDepth > lowest.maxDepth) {
+    QualityLevel deeper = {1, fullDepth, false};
+    levels.push_back(deeper);
+  }
+  if (softShadows) {
+    QualityLevel soft = {1, fullDepth, true};
+    levels.push_back(soft);
+  }
+  for (int samples = 2; samples < fullSamples; samples *= 2) {
+    QualityLevel sampled = {samples, fullDepth, softShadows};
+    levels.push_back(sampled);
+  }
+  if (fullSamples > 1) {
+    QualityLevel full = {fullSamples, fullDepth, softShadows};
+    levels.push_back(full);
+  }
+  predictedMs.assign(levels.size(), 0);
+  measuredMs.assign(levels.size(), 0);
+}
+
+/**
+ * @brief Records the probe of a tile. Tiles are probed, and then traced, in
+ * the same order.
+ *
+ * @param tile The tile's position in the order.
+ * @param tileCells The number of cells in the tile.
+ * @param ms The time the probe took.
+ * @param rays The number of rays the probe traced.
+ */
+void DeadlinePlanner::probed(size_t tile, int tileCells, float ms, int rays) {
+  if (tile >= cells.size()) {
+    cells.resize(tile + 1);
+    costPerSample.resize(tile + 1);
+    tileLevels.resize(tile + 1, -1);
+  }
+  cells[tile] = tileCells;
+  costPerSample[tile] = ms / max(rays, 1);
+  primaryRays += rays;
+}
+
+/**
+ * @brief The ratio of measured to predicted time of the tiles traced at a
+ * level, or of the nearest level above it with any. Probes trace at full
+ * quality, so with no measurements at all the prediction is used as it is.
+ *
+ * @param at
+ * @return float
+ */
+float DeadlinePlanner::correction(int at) const {
+  for (size_t l = at; l < levels.size(); l++) {
+    if (predictedMs[l] > 0) {
+      return (float)(measuredMs[l] / predictedMs[l]);
+    }
+  }
+  return 1;
+}
+
+double DeadlinePlanner::predict(size_t tile, int at) const {
+  return (double)costPerSample[tile] * cells[tile] * levels[at].samples;
+}
+
+/**
+ * @brief Predicts the time the next tile and all those after it take at a
+ * level.
+ *
+ * @param at
+ * @return double
+ */
+double DeadlinePlanner::predictRest(int at) const {
+  double total = 0;
+  for (size_t t = next; t < cells.size(); t++) {
+    total += predict(t, at);
+  }
+  return total * correction(at);
+}
+
+/**
+ * @brief Chooses the level of the next tile.
+ *
+ * @param remainingMs The time left before the image is due.
+ * @return int The level, or -1 if the tile should keep its probed pixels.
+ */
+int DeadlinePlanner::chooseLevel(float remainingMs) {
+  float planned = remainingMs * PLANNED_FRACTION;
+  int top = (int)levels.size() - 1;
+  if (level < 0) {
+    level = top;
+  }
+  while (level > 0 && predictRest(level) > planned) {
+    level--;
+  }
+  while (level < top && predictRest(level + 1) <= planned) {
+    level++;
+  }
+
+  // Rather than spend the time left on the next few tiles, only the fraction
+  // of the remaining tiles that fits is traced, one every so many tiles
+  double rest = predictRest(level);
+  if (level == 0 && rest > planned) {
+    share += (float)(planned / rest);
+    if (share < 1) {
+      return -1;
+    }
+    share -= 1;
+  }
+
+  if (predict(next, level) * correction(level) > remainingMs) {
+    return -1;
+  }
+  return level;
+}
+
+/**
+ * @brief Records the time the next tile took at the level chosen for it, or
+ * skips it if it kept its probed pixels.
+ *
+ * @param ms
+ */
+void DeadlinePlanner::traced(float ms) {
+  if (ms >= 0) {
+    tileLevels[next] = level;
+    predictedMs[level] += predict(next, level);
+    measuredMs[level] += ms;
+    primaryRays += (double)cells[next] * levels[level].samples;
+  }
+  next++;
+}
+
+/**
+ * @brief Prints how many tiles were traced at each level, and the mean
+ * samples per cell of the image.
+ *
+ * @param out
+ */
+void DeadlinePlanner::report(ostream &out) const {
+  vector<int> tilesAt(levels.size(), 0);
+  int probedOnly = 0;
+  double samples = 0;
+  double totalCells = 0;
+  for (size_t t = 0; t < tileLevels.size(); t++) {
+    totalCells += cells[t];
+    if (tileLevels[t] < 0) {
+      probedOnly++;
+      continue;
+    }
+    tilesAt[tileLevels[t]]++;
+    samples += (double)cells[t] * levels[tileLevels[t]].samples;
+  }
+
+  for (size_t l = 0; l < levels.size(); l++) {
+    if (tilesAt[l] == 0) {
+      continue;
+    }
+    out << "  " << tilesAt[l] << (tilesAt[l] == 1 ? " tile" : " tiles")
+        << " at " << levels[l].samples
+        << (levels[l].samples == 1 ? " sample" : " samples") << ", depth "
+        << levels[l].maxDepth
+        << (levels[l].softShadows ? ", soft shadows" : ", hard shadows");
+    if (predictedMs[l] > 0) {
+      out << " (" << measuredMs[l] / predictedMs[l] << "x predicted time)";
+    }
+    out << endl;
+  }
+  if (probedOnly > 0) {
+    out << "  " << probedOnly << (probedOnly == 1 ? " tile" : " tiles")
+        << " left at probe quality" << endl;
+  }
+  out << "  " << samples / max(totalCells, 1.0)
+      << " samples per cell on average" << endl;
+}
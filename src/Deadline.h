@@ -0,0 +1,64 @@
+#ifndef H_DEADLINE
+#define H_DEADLINE
+
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief One set of quality settings a tile can be traced with.
+ *
+ */
+struct QualityLevel {
+  int samples;      // Samples per cell
+  int maxDepth;     // Most levels of recursion
+  bool softShadows; // Whether shadow rays are spread over the lights
+};
+
+/**
+ * @brief Chooses the quality of each tile of an image which must be finished
+ * within a fixed time.
+ *
+ * Every tile is first probed with one ray per block of cells at full quality,
+ * which gives a complete, blocky image and the cost of a sample in each tile.
+ * The tiles are then traced again one at a time, each at the best level whose
+ * predicted cost, for this tile and all those after it, fits in the time left.
+ * Predictions are corrected per level by the ratio of measured to predicted
+ * time of the tiles already traced, so the levels follow the measured cost as
+ * the render goes. When even the lowest level can't afford every tile left,
+ * an even share of them is traced, spread over the rest of the image, and the
+ * others keep their probed pixels.
+ */
+class DeadlinePlanner {
+private:
+  std::vector<QualityLevel> levels;
+  std::vector<float> costPerSample; // Predicted ms per sample, per tile
+  std::vector<int> cells;           // Cells per tile
+  std::vector<int> tileLevels;      // The level each tile was traced at
+  std::vector<double> predictedMs;  // Per level, for the tiles traced at it
+  std::vector<double> measuredMs;
+  size_t next;
+  int level;
+  float share;        // Accumulated fraction of tiles to trace at the lowest
+  double primaryRays; // Traced by the probes and the tiles so far
+
+  float correction(int at) const;
+  double predict(size_t tile, int at) const;
+  double predictRest(int at) const;
+
+public:
+  DeadlinePlanner(int fullSamples, int fullDepth, bool softShadows);
+
+  void probed(size_t tile, int tileCells, float ms, int rays);
+
+  int chooseLevel(float remainingMs);
+
+  void traced(float ms);
+
+  const QualityLevel &getLevel(int at) const { return levels[at]; }
+
+  double getPrimaryRays() const { return primaryRays; }
+
+  void report(std::ostream &out) const;
+};
+
+#endif //! H_DEADLINE
@@ -0,0 +1,468 @@
+#include "Distributed.h"
+#include <algorithm>
+#include <deque>
+#include <errno.h>
+#include <iostream>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+// How often the coordinator wakes up to look for slow tiles
+const int POLL_MS = 50;
+
+// How long to wait for a worker to connect before tracing tiles locally
+const int WORKER_WAIT_MS = 2000;
+
+// A tile taking this many times longer than the average tile is given out
+// again to an idle worker
+const float SLOW_TILE_FACTOR = 3.0;
+
+// The most workers a single tile is given to at the same time
+const int MAX_TILE_COPIES = 2;
+
+// The longest description of its settings a worker may send
+const int MAX_SETTINGS_LENGTH = 4096;
+
+/**
+ * @brief A request from the coordinator for a worker to trace a tile. An `id`
+ * of -1 tells the worker to exit.
+ *
+ */
+struct TileJob {
+  int id;
+  Tile tile;
+  int divisions;
+  int samples;
+  Camera camera;
+};
+
+/**
+ * @brief Sent by a worker before the pixels of a traced tile.
+ *
+ */
+struct TileResult {
+  int id;
+  int count;
+};
+
+/**
+ * @brief Reads exactly `size` bytes, retrying on short reads.
+ *
+ * @return true All bytes were read.
+ * @return false The connection was closed or failed.
+ */
+static bool readFully(int fd, void *data, size_t size) {
+  char *bytes = (char *)data;
+  while (size > 0) {
+    ssize_t n = recv(fd, bytes, size, 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    size -= n;
+  }
+  return true;
+}
+
+/**
+ * @brief Writes exactly `size` bytes, retrying on short writes. A closed
+ * connection is reported as a failure rather than raising `SIGPIPE`.
+ *
+ * @return true All bytes were written.
+ * @return false The connection was closed or failed.
+ */
+static bool writeFully(int fd, const void *data, size_t size) {
+  const char *bytes = (const char *)data;
+  while (size > 0) {
+    ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    size -= n;
+  }
+  return true;
+}
+
+/**
+ * @brief Fills in a Unix domain socket address for `path`.
+ *
+ * @return true The path fits in the address.
+ * @return false The path is too long.
+ */
+static bool socketAddress(const char *path, sockaddr_un *address) {
+  memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address->sun_path)) {
+    cerr << "Socket path is too long: " << path << endl;
+    return false;
+  }
+  strcpy(address->sun_path, path);
+  return true;
+}
+
+static float millisecondsSince(chrono::steady_clock::time_point start) {
+  chrono::duration<float, milli> elapsed = chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+TileCoordinator::TileCoordinator(const char *path,
+                                 const string &renderSettings)
+    : socketPath(path), settings(renderSettings), listenFd(-1) {}
+
+/**
+ * @brief Tells every worker to exit, and removes the socket.
+ *
+ */
+TileCoordinator::~TileCoordinator() {
+  TileJob shutdown;
+  shutdown.id = -1;
+  for (size_t i = 0; i < workers.size(); i++) {
+    writeFully(workers[i].fd, &shutdown, sizeof(shutdown));
+    close(workers[i].fd);
+  }
+  if (listenFd >= 0) {
+    close(listenFd);
+    unlink(socketPath.c_str());
+  }
+  for (size_t i = 0; i < children.size(); i++) {
+    waitpid(children[i], NULL, 0);
+  }
+}
+
+/**
+ * @brief Starts listening for workers on the coordinator's socket. Any stale
+ * socket left at the same path is replaced.
+ *
+ * @return true The coordinator is listening.
+ * @return false The socket could not be created.
+ */
+bool TileCoordinator::listen() {
+  sockaddr_un address;
+  if (!socketAddress(socketPath.c_str(), &address)) {
+    return false;
+  }
+
+  listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFd < 0) {
+    cerr << "Could not create socket: " << strerror(errno) << endl;
+    return false;
+  }
+
+  unlink(socketPath.c_str());
+  if (bind(listenFd, (sockaddr *)&address, sizeof(address)) < 0 ||
+      ::listen(listenFd, SOMAXCONN) < 0) {
+    cerr << "Could not listen on " << socketPath << ": " << strerror(errno)
+         << endl;
+    close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+
+  cout << "Coordinator listening on " << socketPath << endl;
+  return true;
+}
+
+/**
+ * @brief Forks `count` worker processes on this machine. Each worker connects
+ * back to the coordinator's socket, and shares the scene the coordinator had
+ * already loaded when it was forked.
+ *
+ * @param count
+ * @param render The function the workers trace tiles with.
+ */
+void TileCoordinator::spawnLocalWorkers(int count, TileRenderer render) {
+  cout.flush();
+  cerr.flush();
+  for (int i = 0; i < count; i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(listenFd);
+      // _exit skips the parent's destructors, which would remove the socket
+      _exit(runWorker(socketPath.c_str(), settings, render));
+    } else if (pid > 0) {
+      children.push_back(pid);
+    } else {
+      cerr << "Could not fork worker: " << strerror(errno) << endl;
+    }
+  }
+}
+
+/**
+ * @brief Accepts a worker that is waiting to connect, if the settings it sends
+ * match the coordinator's. The worker is told whether it was accepted.
+ *
+ * @return true A worker was accepted.
+ * @return false No worker could be accepted.
+ */
+bool TileCoordinator::acceptWorker() {
+  int fd = accept(listenFd, NULL, NULL);
+  if (fd < 0) {
+    return false;
+  }
+
+  int length = 0;
+  string workerSettings;
+  if (!readFully(fd, &length, sizeof(length)) || length < 0 ||
+      length > MAX_SETTINGS_LENGTH) {
+    close(fd);
+    return false;
+  }
+  workerSettings.resize(length);
+  int accepted = 0;
+  if (readFully(fd, &workerSettings[0], length)) {
+    accepted = workerSettings == settings;
+  }
+  if (!accepted) {
+    cerr << "Turned away a worker tracing with other settings:\n"
+         << "  worker:      " << workerSettings << "\n"
+         << "  coordinator: " << settings << endl;
+  }
+  if (!writeFully(fd, &accepted, sizeof(accepted)) || !accepted) {
+    close(fd);
+    return false;
+  }
+
+  Worker worker;
+  worker.fd = fd;
+  worker.tile = -1;
+  workers.push_back(worker);
+  return true;
+}
+
+/**
+ * @brief Disconnects a worker that has failed.
+ *
+ * @param index The worker's index in `workers`.
+ */
+void TileCoordinator::dropWorker(int index) {
+  close(workers[index].fd);
+  workers.erase(workers.begin() + index);
+  cerr << "Lost a worker, " << workers.size() << " remaining" << endl;
+}
+
+/**
+ * @brief Traces an image by handing out its tiles to the connected workers,
+ * in the order they are given. If no workers are connected for a while, the
+ * remaining tiles are traced in this process instead, so an image is always
+ * produced.
+ *
+ * @param camera The camera the image is traced from.
+ * @param divisions The number of cells along x and y.
+ * @param samples The number of samples per cell.
+ * @param tiles The tiles covering the image.
+ * @param render Used to trace tiles locally if there are no workers.
+ * @param sink Receives each traced tile once, in the order they finish.
+ */
+void TileCoordinator::render(const Camera &camera, int divisions, int samples,
+                             const vector<Tile> &tiles, TileRenderer render,
+                             TileSink *sink) {
+  vector<bool> done(tiles.size(), false);
+  vector<int> copies(tiles.size(), 0);
+  deque<int> pending;
+  for (size_t i = 0; i < tiles.size(); i++) {
+    pending.push_back(i);
+  }
+
+  size_t remaining = tiles.size();
+  int largestTile = 0;
+  for (size_t i = 0; i < tiles.size(); i++) {
+    largestTile = max(largestTile, tiles[i].width * tiles[i].height);
+  }
+  vector<glm::vec3> pixels(largestTile);
+  float totalTileMs = 0;
+  int timedTiles = 0;
+  int reissued = 0;
+  chrono::steady_clock::time_point lastWorkerSeen = chrono::steady_clock::now();
+
+  while (remaining > 0) {
+    // Give a tile to every idle worker
+    for (int w = (int)workers.size() - 1; w >= 0; w--) {
+      if (workers[w].tile >= 0) {
+        continue;
+      }
+
+      int next = -1;
+      while (!pending.empty() && next < 0) {
+        next = pending.front();
+        pending.pop_front();
+        if (done[next]) {
+          next = -1;
+        }
+      }
+
+      // Nothing left to give out, so help with the slowest tile instead
+      if (next < 0 && timedTiles > 0) {
+        float slowMs = SLOW_TILE_FACTOR * totalTileMs / timedTiles;
+        for (size_t o = 0; o < workers.size(); o++) {
+          int t = workers[o].tile;
+          if (t >= 0 && !done[t] && copies[t] < MAX_TILE_COPIES &&
+              millisecondsSince(workers[o].started) > slowMs) {
+            slowMs = millisecondsSince(workers[o].started);
+            next = t;
+          }
+        }
+        if (next >= 0) {
+          reissued++;
+        }
+      }
+
+      if (next < 0) {
+        break;
+      }
+
+      TileJob job;
+      job.id = next;
+      job.tile = tiles[next];
+      job.divisions = divisions;
+      job.samples = samples;
+      job.camera = camera;
+      workers[w].tile = next;
+      workers[w].started = chrono::steady_clock::now();
+      copies[next]++;
+      if (!writeFully(workers[w].fd, &job, sizeof(job))) {
+        copies[next]--;
+        pending.push_front(next);
+        dropWorker(w);
+      }
+    }
+
+    if (workers.empty()) {
+      if (millisecondsSince(lastWorkerSeen) > WORKER_WAIT_MS) {
+        cerr << "No workers connected, tracing the remaining tiles locally"
+             << endl;
+        while (!pending.empty()) {
+          int t = pending.front();
+          pending.pop_front();
+          if (!done[t]) {
+            render(camera, tiles[t], divisions, samples, pixels.data());
+            sink->setTile(tiles[t], pixels.data());
+            done[t] = true;
+            remaining--;
+          }
+        }
+        continue;
+      }
+    } else {
+      lastWorkerSeen = chrono::steady_clock::now();
+    }
+
+    vector<pollfd> fds(workers.size() + 1);
+    fds[0].fd = listenFd;
+    fds[0].events = POLLIN;
+    for (size_t w = 0; w < workers.size(); w++) {
+      fds[w + 1].fd = workers[w].fd;
+      fds[w + 1].events = POLLIN;
+    }
+    if (poll(fds.data(), fds.size(), POLL_MS) <= 0) {
+      continue;
+    }
+
+    // Collect finished tiles, from the back so dropped workers don't shift
+    // the workers that are still to be checked
+    for (int w = (int)workers.size() - 1; w >= 0; w--) {
+      if (fds[w + 1].revents == 0) {
+        continue;
+      }
+
+      int held = workers[w].tile;
+      TileResult result;
+      bool ok = held >= 0 &&
+                readFully(workers[w].fd, &result, sizeof(result)) &&
+                held == result.id &&
+                result.count == tiles[held].width * tiles[held].height &&
+                readFully(workers[w].fd, pixels.data(),
+                          result.count * sizeof(glm::vec3));
+      if (!ok) {
+        if (held >= 0 && !done[held]) {
+          copies[held]--;
+          pending.push_front(held);
+        }
+        dropWorker(w);
+        continue;
+      }
+
+      copies[held]--;
+      workers[w].tile = -1;
+      if (!done[held]) {
+        sink->setTile(tiles[held], pixels.data());
+        done[held] = true;
+        remaining--;
+        totalTileMs += millisecondsSince(workers[w].started);
+        timedTiles++;
+      }
+    }
+
+    if (fds[0].revents & POLLIN) {
+      acceptWorker();
+    }
+  }
+
+  cout << "Traced " << tiles.size() << " tiles, " << reissued
+       << " given out again for being slow" << endl;
+}
+
+/**
+ * @brief Connects to a coordinator and traces the tiles it hands out, until
+ * the coordinator tells the worker to exit or disconnects.
+ *
+ * @param socketPath The coordinator's socket.
+ * @param renderSettings The worker's `describeRenderSettings`, which must be
+ * the same as the coordinator's.
+ * @param render The function used to trace each tile.
+ * @return int The process exit status.
+ */
+int runWorker(const char *socketPath, const string &renderSettings,
+              TileRenderer render) {
+  sockaddr_un address;
+  if (!socketAddress(socketPath, &address)) {
+    return 1;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (sockaddr *)&address, sizeof(address)) < 0) {
+    cerr << "Could not connect to " << socketPath << ": " << strerror(errno)
+         << endl;
+    return 1;
+  }
+
+  int length = renderSettings.size();
+  int accepted = 0;
+  if (!writeFully(fd, &length, sizeof(length)) ||
+      !writeFully(fd, renderSettings.data(), length) ||
+      !readFully(fd, &accepted, sizeof(accepted)) || !accepted) {
+    cerr << "The coordinator at " << socketPath << " did not accept this "
+         << "worker; start it with the coordinator's options" << endl;
+    close(fd);
+    return 1;
+  }
+
+  vector<glm::vec3> pixels;
+  TileJob job;
+  while (readFully(fd, &job, sizeof(job)) && job.id >= 0) {
+    pixels.resize(job.tile.width * job.tile.height);
+    render(job.camera, job.tile, job.divisions, job.samples, pixels.data());
+
+    TileResult result;
+    result.id = job.id;
+    result.count = pixels.size();
+    if (!writeFully(fd, &result, sizeof(result)) ||
+        !writeFully(fd, pixels.data(), pixels.size() * sizeof(glm::vec3))) {
+      break;
+    }
+  }
+
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef H_DISTRIBUTED
+#define H_DISTRIBUTED
+
+#include "Camera.h"
+#include "Tile.h"
+#include "TileSink.h"
+#include <chrono>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Traces the cells of `tile` into `pixels`, which holds
+ * `tile.width * tile.height` colours stored row by row from the bottom row.
+ *
+ */
+typedef void (*TileRenderer)(const Camera &camera, const Tile &tile,
+                             int divisions, int samples, glm::vec3 *pixels);
+
+/**
+ * @brief Hands out the tiles of an image to worker processes over a Unix
+ * domain socket, and passes the traced tiles on as they arrive.
+ *
+ * Tiles are given out one at a time as workers become idle, so faster workers
+ * take more tiles. Once every tile has been given out, idle workers are also
+ * given copies of tiles that have taken much longer than average, and the
+ * first copy to finish is kept. Tiles held by a worker that disconnects are
+ * given out again. Each tile is traced from its coordinates alone, so the
+ * final image does not depend on which worker traced which tile.
+ *
+ * Every other setting a tile is traced with comes from each process's own
+ * command line, so a worker sends a description of its settings when it
+ * connects, and is turned away unless it matches the coordinator's.
+ *
+ * The coordinator and workers exchange structs in the host's memory layout, so
+ * every worker must be the same binary on the same machine.
+ */
+class TileCoordinator {
+private:
+  struct Worker {
+    int fd;
+    int tile; // -1 if idle
+    std::chrono::steady_clock::time_point started;
+  };
+
+  std::string socketPath;
+  std::string settings; // From `describeRenderSettings`
+  int listenFd;
+  std::vector<Worker> workers;
+  std::vector<int> children;
+
+  bool acceptWorker();
+  void dropWorker(int index);
+
+public:
+  TileCoordinator(const char *path, const std::string &renderSettings);
+  ~TileCoordinator();
+
+  bool listen();
+
+  void spawnLocalWorkers(int count, TileRenderer render);
+
+  void render(const Camera &camera, int divisions, int samples,
+              const std::vector<Tile> &tiles, TileRenderer render,
+              TileSink *sink);
+};
+
+int runWorker(const char *socketPath, const std::string &renderSettings,
+              TileRenderer render);
+
+#endif //! H_DISTRIBUTED
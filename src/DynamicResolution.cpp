@@ -0,0 +1,69 @@
+#include "DynamicResolution.h"
+#include <math.h>
+
+// Weight given to the newest measurement when smoothing the sample cost
+const float COST_SMOOTHING = 0.3;
+
+// The reduced resolution is rounded down to a multiple of this, so that small
+// fluctuations in frame time don't change the resolution every frame
+const int DIVISION_STEP = 10;
+
+/**
+ * @brief Records whether the camera is moving. Stopping the camera immediately
+ * restores the full resolution and sample count.
+ *
+ * @param isMoving
+ */
+void DynamicResolution::setMoving(bool isMoving) {
+  moving = isMoving;
+  chooseSettings();
+}
+
+/**
+ * @brief Feeds the measured time of the frame that was just rendered back into
+ * the controller, and chooses the settings for the next frame. Frames are
+ * traced in the background, so the settings may have changed since the frame
+ * was started.
+ *
+ * @param frameMs The measured wall-clock time of the frame, in milliseconds.
+ * @param frameDivisions The number of cells along x and y in the frame.
+ * @param frameSamples The number of samples per cell in the frame.
+ */
+void DynamicResolution::frameRendered(float frameMs, int frameDivisions,
+                                      int frameSamples) {
+  float traced = (float)frameDivisions * frameDivisions * frameSamples;
+  float cost = frameMs / traced;
+
+  if (sampleCostMs < 0) {
+    sampleCostMs = cost;
+  } else {
+    sampleCostMs = COST_SMOOTHING * cost + (1 - COST_SMOOTHING) * sampleCostMs;
+  }
+
+  chooseSettings();
+}
+
+/**
+ * @brief Picks the largest resolution (with a single sample per pixel) whose
+ * predicted frame time is within the target.
+ *
+ */
+void DynamicResolution::chooseSettings() {
+  if (!moving || sampleCostMs <= 0) {
+    divisions = fullDivisions;
+    samples = fullSamples;
+    return;
+  }
+
+  samples = 1;
+  int affordable = (int)sqrtf(targetFrameMs / sampleCostMs);
+  affordable -= affordable % DIVISION_STEP;
+
+  if (affordable < minDivisions) {
+    divisions = minDivisions;
+  } else if (affordable > fullDivisions) {
+    divisions = fullDivisions;
+  } else {
+    divisions = affordable;
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef H_DYNAMIC_RESOLUTION
+#define H_DYNAMIC_RESOLUTION
+
+/**
+ * @brief Chooses the traced resolution and the number of samples per pixel for
+ * the next frame. While the camera is moving, the resolution is lowered until
+ * the measured frame time meets the target. Once the camera stops, full quality
+ * is restored.
+ *
+ */
+class DynamicResolution {
+private:
+  int fullDivisions;
+  int fullSamples;
+  int minDivisions;
+  float targetFrameMs;
+
+  /**
+   * @brief Smoothed cost of tracing a single sample, in milliseconds. This is
+   * negative until the first frame has been measured.
+   *
+   */
+  float sampleCostMs;
+
+  int divisions;
+  int samples;
+  bool moving;
+
+  void chooseSettings();
+
+public:
+  DynamicResolution(int fullDivs, int fullSpp, int minDivs, float targetMs)
+      : fullDivisions(fullDivs), fullSamples(fullSpp), minDivisions(minDivs),
+        targetFrameMs(targetMs), sampleCostMs(-1), divisions(fullDivs),
+        samples(fullSpp), moving(false) {}
+
+  void setMoving(bool isMoving);
+
+  bool isMoving() const { return moving; }
+
+  void frameRendered(float frameMs, int frameDivisions, int frameSamples);
+
+  int getDivisions() const { return divisions; }
+
+  int getSamples() const { return samples; }
+
+  float getTargetFrameMs() const { return targetFrameMs; }
+};
+
+#endif //! H_DYNAMIC_RESOLUTION
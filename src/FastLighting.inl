@@ -0,0 +1,83 @@
+// The body of the wide fast lighting kernel. Lighting.cpp includes this file
+// once for each instruction set, inside a namespace which defines `Lanes`: the
+// vector type `Lanes::V` of `Lanes::WIDTH` floats and the operations on it.
+
+/**
+ * @brief Computes the lighting terms of `Lanes::WIDTH` points at once, with
+ * the same approximations as `fastLighting`.
+ *
+ */
+static void fastLightingWide(const glm::vec3 *lights, const glm::vec3 *points,
+                             const glm::vec3 *normals, LocalLighting *out) {
+  const int width = Lanes::WIDTH;
+
+  // Gather the points and normals into one row per coordinate
+  float rows[6][width];
+  for (int i = 0; i < width; i++) {
+    rows[0][i] = points[i].x;
+    rows[1][i] = points[i].y;
+    rows[2][i] = points[i].z;
+    rows[3][i] = normals[i].x;
+    rows[4][i] = normals[i].y;
+    rows[5][i] = normals[i].z;
+  }
+  Lanes::V px = Lanes::load(rows[0]);
+  Lanes::V py = Lanes::load(rows[1]);
+  Lanes::V pz = Lanes::load(rows[2]);
+  Lanes::V nx = Lanes::load(rows[3]);
+  Lanes::V ny = Lanes::load(rows[4]);
+  Lanes::V nz = Lanes::load(rows[5]);
+
+  const Lanes::V half = Lanes::set1(0.5f);
+  const Lanes::V threeHalves = Lanes::set1(1.5f);
+  const Lanes::V two = Lanes::set1(2.0f);
+
+  for (int l = 0; l < NUM_LIGHTS; l++) {
+    Lanes::V lx = Lanes::sub(Lanes::set1(lights[l].x), px);
+    Lanes::V ly = Lanes::sub(Lanes::set1(lights[l].y), py);
+    Lanes::V lz = Lanes::sub(Lanes::set1(lights[l].z), pz);
+
+    // 1 / |L|, refined by one Newton-Raphson step
+    Lanes::V lengthSq =
+        Lanes::add(Lanes::add(Lanes::mul(lx, lx), Lanes::mul(ly, ly)),
+                   Lanes::mul(lz, lz));
+    Lanes::V r = Lanes::rsqrt(lengthSq);
+    Lanes::V halfLengthSq = Lanes::mul(half, lengthSq);
+    r = Lanes::mul(r, Lanes::sub(threeHalves,
+                                 Lanes::mul(halfLengthSq, Lanes::mul(r, r))));
+    lx = Lanes::mul(lx, r);
+    ly = Lanes::mul(ly, r);
+    lz = Lanes::mul(lz, r);
+
+    Lanes::V lDotN =
+        Lanes::add(Lanes::add(Lanes::mul(lx, nx), Lanes::mul(ly, ny)),
+                   Lanes::mul(lz, nz));
+
+    // reflect(-L, N) = -L + 2 (L.N) N
+    Lanes::V twoLDotN = Lanes::mul(two, lDotN);
+    Lanes::V rx = Lanes::sub(Lanes::mul(twoLDotN, nx), lx);
+    Lanes::V ry = Lanes::sub(Lanes::mul(twoLDotN, ny), ly);
+    Lanes::V rz = Lanes::sub(Lanes::mul(twoLDotN, nz), lz);
+    Lanes::V rDotV =
+        Lanes::add(Lanes::add(Lanes::mul(rx, nx), Lanes::mul(ry, ny)),
+                   Lanes::mul(rz, nz));
+
+    // x^20 = x^16 * x^4, zeroed where R.V < 0
+    Lanes::V x2 = Lanes::mul(rDotV, rDotV);
+    Lanes::V x4 = Lanes::mul(x2, x2);
+    Lanes::V x16 = Lanes::mul(Lanes::mul(x4, x4), Lanes::mul(x4, x4));
+    Lanes::V specular = Lanes::wherePositive(rDotV, Lanes::mul(x16, x4));
+
+    float vx[width], vy[width], vz[width], dots[width], specs[width];
+    Lanes::store(vx, lx);
+    Lanes::store(vy, ly);
+    Lanes::store(vz, lz);
+    Lanes::store(dots, lDotN);
+    Lanes::store(specs, specular);
+    for (int i = 0; i < width; i++) {
+      out[i].lightVector[l] = glm::vec3(vx[i], vy[i], vz[i]);
+      out[i].lDotN[l] = dots[i];
+      out[i].specular[l] = specs[i];
+    }
+  }
+}
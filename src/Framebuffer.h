@@ -0,0 +1,59 @@
+#ifndef H_FRAMEBUFFER
+#define H_FRAMEBUFFER
+
+#include "Tile.h"
+#include "TileSink.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+/**
+ * @brief Stores the traced colour of every cell in the image. Cell (x, y) is
+ * stored at `y * width + x`, with `y = 0` being the bottom row.
+ *
+ */
+class Framebuffer : public TileSink {
+public:
+  int width;
+  int height;
+  std::vector<glm::vec3> pixels;
+
+  Framebuffer() : width(0), height(0) {}
+
+  Framebuffer(int w, int h) : width(w), height(h), pixels(w * h) {}
+
+  void resize(int w, int h);
+
+  glm::vec3 &at(int x, int y) { return pixels[y * width + x]; }
+
+  const glm::vec3 &at(int x, int y) const { return pixels[y * width + x]; }
+
+  void setTile(const Tile &tile, const glm::vec3 *tilePixels);
+
+  bool writePPM(const char *filename) const;
+
+  bool readPPM(const char *filename);
+};
+
+/**
+ * @brief How far an image is from a reference image, measured on the bytes
+ * written to a PPM file.
+ *
+ */
+struct ImageDifference {
+  int maxDifference;     // The largest difference of any channel
+  double meanDifference; // The mean absolute difference per channel
+  double meanBias;       // The mean of the image minus the reference
+  double psnr;           // Peak signal-to-noise ratio in dB, infinite if equal
+  int differentChannels; // The number of channels which differ at all
+  int pixelsOver;        // Pixels with a channel differing beyond tolerance
+};
+
+unsigned char toByte(float value);
+
+bool compareImages(const Framebuffer &image, const Framebuffer &reference,
+                   int tolerance, ImageDifference *difference);
+
+void differenceHeatmap(const Framebuffer &image, const Framebuffer &reference,
+                       int tolerance, Framebuffer *heatmap);
+
+#endif //! H_FRAMEBUFFER
@@ -0,0 +1,108 @@
+#include "Instance.h"
+#include <math.h>
+
+/**
+ * @brief Construct a new Instance object.
+ *
+ * @param proto The geometry to place.
+ * @param position Where the prototype's origin is placed.
+ * @param scale The scale of the prototype along each of its axes.
+ * @param yRotation The rotation about the y-axis, in radians. The prototype is
+ * scaled, then rotated, then moved to `position`.
+ * @param col
+ */
+Instance::Instance(const Prototype *proto, glm::vec3 position, glm::vec3 scale,
+                   float yRotation, glm::vec3 col)
+    : prototype(proto) {
+  color = col;
+  setTransform(position, scale, yRotation);
+}
+
+/**
+ * @brief Moves the instance. The prototype is scaled, then rotated about the
+ * y-axis, then moved to `position`.
+ *
+ * @param position Where the prototype's origin is placed.
+ * @param scale The scale of the prototype along each of its axes.
+ * @param yRotation The rotation about the y-axis, in radians.
+ */
+void Instance::setTransform(glm::vec3 position, glm::vec3 scale,
+                            float yRotation) {
+  offset = position;
+  float c = cosf(yRotation);
+  float s = sinf(yRotation);
+  glm::mat3 rotation(glm::vec3(c, 0, -s), glm::vec3(0, 1, 0),
+                     glm::vec3(s, 0, c));
+  glm::mat3 scaling(glm::vec3(scale.x, 0, 0), glm::vec3(0, scale.y, 0),
+                    glm::vec3(0, 0, scale.z));
+  toWorld = rotation * scaling;
+  toObject = glm::inverse(toWorld);
+  toNormal = glm::transpose(toObject);
+}
+
+/**
+ * @brief Finds the distance to the closest part of the instance hit by a ray.
+ *
+ * @param posn The source point of the ray, in world space.
+ * @param dir The unit direction of the ray, in world space.
+ * @param part Receives the index of the part which was hit.
+ * @return float The distance along the world space ray, or -1 for no hit.
+ */
+float Instance::intersectPart(glm::vec3 posn, glm::vec3 dir, int *part) {
+  glm::vec3 objectDir = toObject * dir;
+
+  // Parts expect a unit direction, so distances found in object space are
+  // scaled back by the length of the transformed direction
+  float scale = glm::length(objectDir);
+  Ray ray(toObject * (posn - offset), objectDir / scale);
+
+  Hit hit = prototype->closestHit(ray);
+  *part = hit.index;
+  if (hit.index == -1) {
+    return -1;
+  }
+  return hit.t / scale;
+}
+
+float Instance::intersect(glm::vec3 posn, glm::vec3 dir) {
+  int part;
+  return intersectPart(posn, dir, &part);
+}
+
+/**
+ * @brief Returns the unit normal of a part at a point on its surface.
+ *
+ * @param p The point, in world space.
+ * @param part The index of the part, from `intersectPart`.
+ * @return glm::vec3
+ */
+glm::vec3 Instance::normalOfPart(glm::vec3 p, int part) {
+  glm::vec3 n = prototype->parts[part]->normal(toObject * (p - offset));
+  return glm::normalize(toNormal * n);
+}
+
+/**
+ * @brief Returns the normal of the first part. A point alone does not say
+ * which part it is on, so callers should use `normalOfPart` instead.
+ *
+ * @param p
+ * @return glm::vec3
+ */
+glm::vec3 Instance::normal(glm::vec3 p) { return normalOfPart(p, 0); }
+
+/**
+ * @brief Returns the world space box enclosing the prototype's box.
+ *
+ * @return AABB
+ */
+AABB Instance::bounds() {
+  AABB local = prototype->bounds();
+  AABB box;
+  for (int corner = 0; corner < 8; corner++) {
+    glm::vec3 p(corner & 1 ? local.hi.x : local.lo.x,
+                corner & 2 ? local.hi.y : local.lo.y,
+                corner & 4 ? local.hi.z : local.lo.z);
+    box.expand(toWorld * p + offset);
+  }
+  return box;
+}
@@ -0,0 +1,75 @@
+#ifndef H_INSTANCE
+#define H_INSTANCE
+
+#include "BVH.h"
+#include "SceneObject.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+/**
+ * @brief Geometry which is stored once and placed in the scene any number of
+ * times by `Instance`s. The parts are given in the prototype's own object
+ * space, and are not owned by the prototype.
+ *
+ */
+class Prototype {
+private:
+  BVH bvh;
+
+public:
+  /**
+   * @brief The objects the prototype is made of. `build()` must be called
+   * after the parts are added.
+   *
+   */
+  std::vector<SceneObject *> parts;
+
+  void build() { bvh.build(parts); }
+
+  AABB bounds() const { return bvh.bounds(); }
+
+  /**
+   * @brief Finds the closest part hit by a ray in object space. The index of
+   * the hit is the index of the part.
+   *
+   */
+  Hit closestHit(const Ray &ray) const { return bvh.closestHit(ray, parts); }
+};
+
+/**
+ * @brief A placement of a prototype in the scene. The instance stores only its
+ * transform and material, so many instances of a prototype cost little more
+ * memory than one.
+ *
+ * Rays are moved into the prototype's object space to be intersected, and
+ * normals are moved back into world space. The transform may be changed
+ * between frames to move the instance, after which the scene's BVH must be
+ * refitted.
+ *
+ */
+class Instance : public SceneObject {
+private:
+  const Prototype *prototype;
+  glm::mat3 toWorld;  // The rotation and scale of the instance
+  glm::mat3 toObject; // The inverse of `toWorld`
+  glm::mat3 toNormal; // Transforms object space normals to world space
+  glm::vec3 offset;   // The position of the prototype's origin
+
+public:
+  Instance(const Prototype *proto, glm::vec3 position, glm::vec3 scale,
+           float yRotation, glm::vec3 col);
+
+  void setTransform(glm::vec3 position, glm::vec3 scale, float yRotation);
+
+  float intersect(glm::vec3 posn, glm::vec3 dir);
+
+  float intersectPart(glm::vec3 posn, glm::vec3 dir, int *part);
+
+  glm::vec3 normal(glm::vec3 p);
+
+  glm::vec3 normalOfPart(glm::vec3 p, int part);
+
+  AABB bounds();
+};
+
+#endif //! H_INSTANCE
@@ -0,0 +1,222 @@
+#include "Lighting.h"
+#include "FastMath.h"
+#include <math.h>
+
+// The wide kernels need x86-64 and the target pragmas of GCC and Clang
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_LIGHTING
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Computes the lighting terms of one point with the standard library.
+ *
+ */
+static void exactLighting(const glm::vec3 *lights, glm::vec3 point,
+                          glm::vec3 normal, LocalLighting *out) {
+  for (int l = 0; l < NUM_LIGHTS; l++) {
+    // vector from the point of intersection towards the light source
+    glm::vec3 lightVector = glm::normalize(lights[l] - point);
+    float lDotN = glm::dot(lightVector, normal);
+
+    // first param: incident light's direction (unit vector from light source
+    // to the point of intersection)
+    glm::vec3 reflVector = glm::reflect(-lightVector, normal);
+    float rDotV = glm::dot(reflVector, normal);
+
+    out->lightVector[l] = lightVector;
+    out->lDotN[l] = lDotN;
+    out->specular[l] = rDotV < 0.0 ? 0.0 : pow(rDotV, 20.0);
+  }
+}
+
+/**
+ * @brief Computes the lighting terms of one point with the approximations in
+ * FastMath.h.
+ *
+ */
+static void fastLighting(const glm::vec3 *lights, glm::vec3 point,
+                         glm::vec3 normal, LocalLighting *out) {
+  for (int l = 0; l < NUM_LIGHTS; l++) {
+    glm::vec3 toLight = lights[l] - point;
+    glm::vec3 lightVector = toLight * fastRsqrt(glm::dot(toLight, toLight));
+    float lDotN = glm::dot(lightVector, normal);
+
+    // reflect(-L, N) = -L + 2 (L.N) N
+    glm::vec3 reflVector = 2 * lDotN * normal - lightVector;
+    float rDotV = glm::dot(reflVector, normal);
+
+    out->lightVector[l] = lightVector;
+    out->lDotN[l] = lDotN;
+    out->specular[l] = rDotV < 0 ? 0 : fastPow20(rDotV);
+  }
+}
+
+#if defined(SIMD_LIGHTING)
+// SSE2 is part of x86-64, so the generic kernel works four points at a time
+namespace sse2 {
+struct Lanes {
+  typedef __m128 V;
+  static const int WIDTH = 4;
+  static V set1(float x) { return _mm_set1_ps(x); }
+  static V load(const float *p) { return _mm_loadu_ps(p); }
+  static void store(float *p, V a) { _mm_storeu_ps(p, a); }
+  static V add(V a, V b) { return _mm_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static V rsqrt(V a) { return _mm_rsqrt_ps(a); }
+  static V wherePositive(V x, V a) {
+    return _mm_and_ps(_mm_cmpgt_ps(x, _mm_setzero_ps()), a);
+  }
+};
+#include "FastLighting.inl"
+} // namespace sse2
+
+#pragma GCC push_options
+#pragma GCC target("sse4.2")
+namespace sse4 {
+struct Lanes : sse2::Lanes {
+  static V wherePositive(V x, V a) {
+    V zero = _mm_setzero_ps();
+    return _mm_blendv_ps(zero, a, _mm_cmpgt_ps(x, zero));
+  }
+};
+#include "FastLighting.inl"
+} // namespace sse4
+#pragma GCC pop_options
+
+// FMA is left out, so that every kernel rounds the same way
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace avx2 {
+struct Lanes {
+  typedef __m256 V;
+  static const int WIDTH = 8;
+  static V set1(float x) { return _mm256_set1_ps(x); }
+  static V load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, V a) { _mm256_storeu_ps(p, a); }
+  static V add(V a, V b) { return _mm256_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static V rsqrt(V a) { return _mm256_rsqrt_ps(a); }
+  static V wherePositive(V x, V a) {
+    return _mm256_and_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ),
+                         a);
+  }
+};
+#include "FastLighting.inl"
+} // namespace avx2
+#pragma GCC pop_options
+
+// AVX-512 brings FMA with it, so contraction is turned off instead
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#pragma GCC optimize("fp-contract=off")
+namespace avx512 {
+struct Lanes {
+  typedef __m512 V;
+  static const int WIDTH = 16;
+  static V set1(float x) { return _mm512_set1_ps(x); }
+  static V load(const float *p) { return _mm512_loadu_ps(p); }
+  static void store(float *p, V a) { _mm512_storeu_ps(p, a); }
+  static V add(V a, V b) { return _mm512_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+
+  // The 14 bit estimate of AVX-512 would round differently from the other
+  // kernels, so the 12 bit estimate is taken of each half instead
+  static V rsqrt(V a) {
+    float lanes[WIDTH];
+    _mm512_storeu_ps(lanes, a);
+    _mm256_storeu_ps(lanes, _mm256_rsqrt_ps(_mm256_loadu_ps(lanes)));
+    _mm256_storeu_ps(lanes + 8, _mm256_rsqrt_ps(_mm256_loadu_ps(lanes + 8)));
+    return _mm512_loadu_ps(lanes);
+  }
+
+  static V wherePositive(V x, V a) {
+    __mmask16 positive =
+        _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GT_OQ);
+    return _mm512_maskz_mov_ps(positive, a);
+  }
+};
+#include "FastLighting.inl"
+} // namespace avx512
+#pragma GCC pop_options
+
+typedef void (*WideLighting)(const glm::vec3 *lights, const glm::vec3 *points,
+                             const glm::vec3 *normals, LocalLighting *out);
+
+/**
+ * @brief The wide fast lighting kernel chosen by `selectLightingKernels`, and
+ * how many points it shades at once.
+ *
+ */
+static WideLighting wideLighting = &sse2::fastLightingWide;
+static int wideLightingWidth = sse2::Lanes::WIDTH;
+#endif
+
+/**
+ * @brief Chooses the fast lighting kernel compiled for the given instruction
+ * set. Every kernel gives the same results.
+ *
+ * @param level An instruction set the processor supports.
+ */
+void selectLightingKernels(IsaLevel level) {
+#if defined(SIMD_LIGHTING)
+  switch (level) {
+    case ISA_GENERIC:
+      wideLighting = &sse2::fastLightingWide;
+      wideLightingWidth = sse2::Lanes::WIDTH;
+      break;
+    case ISA_SSE4:
+      wideLighting = &sse4::fastLightingWide;
+      wideLightingWidth = sse4::Lanes::WIDTH;
+      break;
+    case ISA_AVX2:
+      wideLighting = &avx2::fastLightingWide;
+      wideLightingWidth = avx2::Lanes::WIDTH;
+      break;
+    case ISA_AVX512:
+      wideLighting = &avx512::fastLightingWide;
+      wideLightingWidth = avx512::Lanes::WIDTH;
+      break;
+  }
+#else
+  (void)level;
+#endif
+}
+
+/**
+ * @brief Computes the direct lighting terms for a batch of points. In
+ * `MATH_FAST` mode, points are shaded as many at a time as the selected wide
+ * kernel allows, then four at a time, and the remainder one at a time.
+ *
+ * @param mode
+ * @param lights The positions of the `NUM_LIGHTS` lights.
+ * @param points The points being shaded.
+ * @param normals The unit normal at each point.
+ * @param count The number of points, at most `SHADING_BATCH`.
+ * @param out Receives the lighting terms of each point.
+ */
+void computeLighting(MathMode mode, const glm::vec3 *lights,
+                     const glm::vec3 *points, const glm::vec3 *normals,
+                     int count, LocalLighting *out) {
+  int i = 0;
+  if (mode == MATH_FAST) {
+#if defined(SIMD_LIGHTING)
+    for (; i + wideLightingWidth <= count; i += wideLightingWidth) {
+      wideLighting(lights, points + i, normals + i, out + i);
+    }
+    for (; i + 4 <= count; i += 4) {
+      sse2::fastLightingWide(lights, points + i, normals + i, out + i);
+    }
+#endif
+    for (; i < count; i++) {
+      fastLighting(lights, points[i], normals[i], out + i);
+    }
+  } else {
+    for (; i < count; i++) {
+      exactLighting(lights, points[i], normals[i], out + i);
+    }
+  }
+}
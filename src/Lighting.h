@@ -0,0 +1,37 @@
+#ifndef H_LIGHTING
+#define H_LIGHTING
+
+#include "CpuDispatch.h"
+#include <glm/glm.hpp>
+
+// The number of point lights in the scene
+const int NUM_LIGHTS = 2;
+
+// The most hits shaded together by `computeLighting`
+const int SHADING_BATCH = 64;
+
+/**
+ * @brief Whether shading uses the standard library (`MATH_EXACT`), or the
+ * approximations in FastMath.h (`MATH_FAST`).
+ *
+ */
+enum MathMode { MATH_EXACT, MATH_FAST };
+
+/**
+ * @brief The direct lighting terms at a point, before shadows are taken into
+ * account.
+ *
+ */
+struct LocalLighting {
+  glm::vec3 lightVector[NUM_LIGHTS]; // unit vectors towards each light
+  float lDotN[NUM_LIGHTS];
+  float specular[NUM_LIGHTS];
+};
+
+void computeLighting(MathMode mode, const glm::vec3 *lights,
+                     const glm::vec3 *points, const glm::vec3 *normals,
+                     int count, LocalLighting *out);
+
+void selectLightingKernels(IsaLevel level);
+
+#endif //! H_LIGHTING
@@ -0,0 +1,165 @@
+#include "LightingCache.h"
+#include <math.h>
+
+// The most records kept. Once full, every lookup near a shadow edge traces
+// its shadow rays
+const size_t MAX_RECORDS = 1 << 18;
+
+// The number of buckets records are hashed into
+const size_t BUCKETS = 1 << 16;
+
+// How many agreeing records a lookup needs before their answer is reused
+const int MIN_RECORDS = 3;
+
+// Records whose normals differ by more than this (as a cosine) are not used
+const float MIN_NORMAL_DOT = 0.95;
+
+// New records are not added closer than this fraction of the spacing to an
+// existing record in the same cell, which bounds how many records a lookup
+// near a shadow edge has to check
+const float MIN_SEPARATION = 0.5;
+
+/**
+ * @brief Sets the distance over which records are interpolated, and clears
+ * the cache if it was made for another spacing or scene. The memory for the
+ * records is allocated on first use.
+ *
+ * @param recordSpacing The radius within which records are used, in world
+ * units, or 0 to disable the cache.
+ * @param sceneGeneration The generation of the current scene.
+ */
+void LightingCache::configure(float recordSpacing, unsigned sceneGeneration) {
+  if (spacing == recordSpacing && generation == sceneGeneration) {
+    return;
+  }
+  spacing = recordSpacing;
+  // Cells twice the radius wide mean the records within the radius are
+  // always in the 2 x 2 x 2 cells nearest the point
+  cellSize = 2 * recordSpacing;
+  generation = sceneGeneration;
+  used = 0;
+  if (!isEnabled()) {
+    return;
+  }
+  records.resize(MAX_RECORDS);
+  buckets.assign(BUCKETS, -1);
+}
+
+/**
+ * @brief Hashes the coordinates of a cell to a bucket.
+ *
+ */
+size_t LightingCache::bucketOf(int x, int y, int z) const {
+  unsigned hash = (unsigned)x * 73856093u ^ (unsigned)y * 19349663u ^
+                  (unsigned)z * 83492791u;
+  return hash & (BUCKETS - 1);
+}
+
+/**
+ * @brief Finds whether the records near a point agree on what blocks each
+ * light.
+ *
+ * @param object The index of the object the point is on.
+ * @param point
+ * @param normal The object's unit normal at `point`.
+ * @param blockers Receives the blocker of each light, if the records agree.
+ * @return true The records agree, and `blockers` is set.
+ * @return false Too few records are near the point, or they disagree, so the
+ * shadow rays must be traced.
+ */
+bool LightingCache::lookup(int object, glm::vec3 point, glm::vec3 normal,
+                           Hit *blockers) {
+  lookups++;
+  glm::vec3 scaled = point / cellSize;
+  int base[3];
+  for (int axis = 0; axis < 3; axis++) {
+    // Start from the lower neighbour when the point is in the lower half of
+    // its cell
+    float cell = floorf(scaled[axis]);
+    base[axis] = (int)cell - (scaled[axis] - cell < 0.5f ? 1 : 0);
+  }
+
+  int found = 0;
+  float radiusSquared = spacing * spacing;
+  for (int corner = 0; corner < 8; corner++) {
+    size_t bucket = bucketOf(base[0] + (corner & 1),
+                             base[1] + (corner >> 1 & 1),
+                             base[2] + (corner >> 2));
+    for (int r = buckets[bucket]; r != -1; r = records[r].next) {
+      const Record &record = records[r];
+      glm::vec3 offset = record.point - point;
+      if (record.object != object ||
+          glm::dot(offset, offset) > radiusSquared ||
+          glm::dot(record.normal, normal) < MIN_NORMAL_DOT) {
+        continue;
+      }
+      for (int light = 0; light < NUM_LIGHTS; light++) {
+        if (found == 0) {
+          blockers[light] = record.blockers[light];
+        } else if (record.blockers[light].index != blockers[light].index) {
+          // A shadow edge passes near the point
+          return false;
+        }
+      }
+      found++;
+    }
+  }
+
+  if (found < MIN_RECORDS) {
+    return false;
+  }
+  reused++;
+  return true;
+}
+
+/**
+ * @brief Adds the traced blockers of each light at a point, unless a record
+ * on the same object is already close by.
+ *
+ * @param object The index of the object the point is on.
+ * @param point
+ * @param normal The object's unit normal at `point`.
+ * @param blockers The closest blocker of each light.
+ */
+void LightingCache::insert(int object, glm::vec3 point, glm::vec3 normal,
+                           const Hit *blockers) {
+  if (used == records.size()) {
+    return;
+  }
+  glm::vec3 scaled = point / cellSize;
+  size_t bucket = bucketOf((int)floorf(scaled.x), (int)floorf(scaled.y),
+                           (int)floorf(scaled.z));
+
+  float separation = spacing * MIN_SEPARATION;
+  for (int r = buckets[bucket]; r != -1; r = records[r].next) {
+    glm::vec3 offset = records[r].point - point;
+    if (records[r].object == object &&
+        glm::dot(offset, offset) < separation * separation) {
+      return;
+    }
+  }
+
+  Record &record = records[used];
+  record.point = point;
+  record.normal = normal;
+  record.object = object;
+  for (int light = 0; light < NUM_LIGHTS; light++) {
+    record.blockers[light] = blockers[light];
+  }
+  record.next = buckets[bucket];
+  buckets[bucket] = used;
+  used++;
+}
+
+/**
+ * @brief Prints how many lookups reused cached lighting.
+ *
+ * @param out
+ */
+void LightingCache::report(std::ostream &out) const {
+  out << "  " << reused << " of " << lookups << " lookups reused";
+  if (lookups > 0) {
+    out << " (" << 100.0 * reused / lookups << "%)";
+  }
+  out << ", " << used << " records stored\n";
+}
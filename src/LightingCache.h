@@ -0,0 +1,72 @@
+#ifndef H_LIGHTING_CACHE
+#define H_LIGHTING_CACHE
+
+#include "Lighting.h"
+#include "Ray.h"
+#include <glm/glm.hpp>
+#include <ostream>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * @brief Caches which object, if any, blocks each light at points on the
+ * scene's surfaces. Shadow rays are the costly part of direct lighting, and
+ * away from shadow edges, nearby points on the same surface see the lights in
+ * the same way.
+ *
+ * A lookup interpolates between the records near a point: if enough records
+ * on the same object, facing the same way, agree on every light's blocker,
+ * their answer is reused. Where they disagree, the point is near a shadow
+ * edge, and the caller must trace the shadow rays and insert the result.
+ *
+ * The records are kept in world space, so they stay valid when the camera
+ * moves. Each thread keeps its own cache, and the memory is allocated once by
+ * `configure`.
+ *
+ */
+class LightingCache {
+private:
+  struct Record {
+    glm::vec3 point;
+    glm::vec3 normal;
+    int object;
+    int next; // The next record in the same bucket, or -1
+    Hit blockers[NUM_LIGHTS];
+  };
+
+  float spacing;
+  float cellSize;
+  unsigned generation;
+  std::vector<Record> records;
+  std::vector<int> buckets;
+  size_t used;
+
+  size_t lookups;
+  size_t reused;
+
+  size_t bucketOf(int x, int y, int z) const;
+
+public:
+  LightingCache()
+      : spacing(0), cellSize(0), generation(0), used(0), lookups(0),
+        reused(0) {}
+
+  void configure(float recordSpacing, unsigned sceneGeneration);
+
+  bool isEnabled() const { return spacing > 0; }
+
+  bool lookup(int object, glm::vec3 point, glm::vec3 normal,
+              Hit *blockers);
+
+  void insert(int object, glm::vec3 point, glm::vec3 normal,
+              const Hit *blockers);
+
+  void clearStats() {
+    lookups = 0;
+    reused = 0;
+  }
+
+  void report(std::ostream &out) const;
+};
+
+#endif //! H_LIGHTING_CACHE
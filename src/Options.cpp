@@ -0,0 +1,462 @@
+#include "Options.h"
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+/**
+ * @brief Reads a positive integer option value.
+ *
+ * @param name The name of the option, for error messages.
+ * @param value The value given on the command line.
+ * @param out Where the parsed value is stored.
+ * @return true The value is a positive integer.
+ * @return false The value is missing or invalid.
+ */
+static bool parsePositive(const char *name, const char *value, int *out) {
+  if (value == NULL) {
+    cerr << "Missing value for " << name << endl;
+    return false;
+  }
+  char *end;
+  long parsed = strtol(value, &end, 10);
+  if (*end != '\0' || parsed <= 0) {
+    cerr << "Invalid value for " << name << ": " << value << endl;
+    return false;
+  }
+  *out = (int)parsed;
+  return true;
+}
+
+/**
+ * @brief Reads a non-negative integer option value.
+ *
+ * @param name The name of the option, for error messages.
+ * @param value The value given on the command line.
+ * @param out Where the parsed value is stored.
+ * @return true The value is zero or a positive integer.
+ * @return false The value is missing or invalid.
+ */
+static bool parseNonNegative(const char *name, const char *value, int *out) {
+  if (value == NULL) {
+    cerr << "Missing value for " << name << endl;
+    return false;
+  }
+  char *end;
+  long parsed = strtol(value, &end, 10);
+  if (*end != '\0' || parsed < 0) {
+    cerr << "Invalid value for " << name << ": " << value << endl;
+    return false;
+  }
+  *out = (int)parsed;
+  return true;
+}
+
+/**
+ * @brief Reads a positive real option value.
+ *
+ * @param name The name of the option, for error messages.
+ * @param value The value given on the command line.
+ * @param out Where the parsed value is stored.
+ * @return true The value is a positive number.
+ * @return false The value is missing or invalid.
+ */
+static bool parsePositiveFloat(const char *name, const char *value,
+                               float *out) {
+  if (value == NULL) {
+    cerr << "Missing value for " << name << endl;
+    return false;
+  }
+  char *end;
+  float parsed = strtof(value, &end);
+  if (*end != '\0' || !(parsed > 0)) {
+    cerr << "Invalid value for " << name << ": " << value << endl;
+    return false;
+  }
+  *out = parsed;
+  return true;
+}
+
+/**
+ * @brief Parses the command line into `options`. Options not given keep their
+ * default values.
+ *
+ * @param argc
+ * @param argv
+ * @param options
+ * @return true The command line is valid.
+ * @return false The command line is invalid, and an error has been printed.
+ */
+bool parseOptions(int argc, char *argv[], Options *options) {
+  options->outputFile = NULL;
+  options->stream = false;
+  options->divisions = 500;
+  options->samples = 4;
+  options->samplePattern = SAMPLES_GRID;
+  options->lightRadius = 0;
+  options->shadows = true;
+  options->glossiness = 0;
+  options->maxDepth = 5;
+  options->minContribution = 0;
+  options->russianRoulette = false;
+  options->tileSize = 32;
+  options->order = ORDER_TILED;
+  options->threads = 1;
+  options->pinThreads = false;
+  options->workers = 0;
+  options->socketPath = NULL;
+  options->workerSocket = NULL;
+  options->serveSocket = NULL;
+  options->fastMath = false;
+  options->isaForced = false;
+  options->isa = ISA_GENERIC;
+  options->scene = "default";
+  options->animate = false;
+  options->frames = 1;
+  options->budgetMs = 0;
+  options->sharedName = NULL;
+  options->views = VIEWS_SINGLE;
+  options->viewCount = 3;
+  options->viewSpacing = 1;
+  options->rasterPrimary = false;
+  options->lightCacheSpacing = 0;
+  options->referenceFile = NULL;
+  options->tolerance = -1;
+  options->heatmapFile = NULL;
+  options->timelineFile = NULL;
+  options->photons = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+    // Flags without a value
+    if (strcmp(arg, "--fast-math") == 0) {
+      options->fastMath = true;
+      continue;
+    }
+    if (strcmp(arg, "--raster-primary") == 0) {
+      options->rasterPrimary = true;
+      continue;
+    }
+    if (strcmp(arg, "--stream") == 0) {
+      options->stream = true;
+      continue;
+    }
+    if (strcmp(arg, "--roulette") == 0) {
+      options->russianRoulette = true;
+      continue;
+    }
+    if (strcmp(arg, "--no-shadows") == 0) {
+      options->shadows = false;
+      continue;
+    }
+    if (strcmp(arg, "--animate") == 0) {
+      options->animate = true;
+      continue;
+    }
+    if (strcmp(arg, "--pin") == 0) {
+      options->pinThreads = true;
+      continue;
+    }
+
+    if (strcmp(arg, "--output") == 0 && value != NULL) {
+      options->outputFile = value;
+    } else if (strcmp(arg, "--size") == 0) {
+      if (!parsePositive(arg, value, &options->divisions)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--samples") == 0) {
+      if (!parsePositive(arg, value, &options->samples)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--sampler") == 0 && value != NULL) {
+      if (strcmp(value, "grid") == 0) {
+        options->samplePattern = SAMPLES_GRID;
+      } else if (strcmp(value, "sobol") == 0) {
+        options->samplePattern = SAMPLES_SOBOL;
+      } else if (strcmp(value, "halton") == 0) {
+        options->samplePattern = SAMPLES_HALTON;
+      } else {
+        cerr << "Unknown sampler: " << value << endl;
+        return false;
+      }
+    } else if (strcmp(arg, "--light-radius") == 0) {
+      if (!parsePositiveFloat(arg, value, &options->lightRadius)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--gloss") == 0) {
+      if (!parsePositiveFloat(arg, value, &options->glossiness)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--max-depth") == 0) {
+      if (!parsePositive(arg, value, &options->maxDepth)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--min-contribution") == 0) {
+      if (!parsePositiveFloat(arg, value, &options->minContribution)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--tile") == 0) {
+      if (!parsePositive(arg, value, &options->tileSize)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--order") == 0 && value != NULL) {
+      if (!parseTileOrder(value, &options->order)) {
+        cerr << "Unknown traversal order: " << value << endl;
+        return false;
+      }
+    } else if (strcmp(arg, "--threads") == 0) {
+      if (!parsePositive(arg, value, &options->threads)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--workers") == 0) {
+      if (!parsePositive(arg, value, &options->workers)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--socket") == 0 && value != NULL) {
+      options->socketPath = value;
+    } else if (strcmp(arg, "--worker") == 0 && value != NULL) {
+      options->workerSocket = value;
+    } else if (strcmp(arg, "--serve") == 0 && value != NULL) {
+      options->serveSocket = value;
+    } else if (strcmp(arg, "--isa") == 0 && value != NULL) {
+      if (!parseIsa(value, &options->isa)) {
+        cerr << "Unknown instruction set: " << value << endl;
+        return false;
+      }
+      options->isaForced = true;
+    } else if (strcmp(arg, "--scene") == 0 && value != NULL) {
+      if (strcmp(value, "default") != 0 && strcmp(value, "crates") != 0 &&
+          strcmp(value, "mirrors") != 0) {
+        cerr << "Unknown scene: " << value << endl;
+        return false;
+      }
+      options->scene = value;
+    } else if (strcmp(arg, "--frames") == 0) {
+      if (!parsePositive(arg, value, &options->frames)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--budget") == 0) {
+      if (!parsePositiveFloat(arg, value, &options->budgetMs)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--shared") == 0 && value != NULL) {
+      if (value[0] != '/' || strchr(value + 1, '/') != NULL) {
+        cerr << "A shared memory name is a / followed by a name without "
+                "slashes: "
+             << value << endl;
+        return false;
+      }
+      options->sharedName = value;
+    } else if (strcmp(arg, "--views") == 0 && value != NULL) {
+      if (!parseViewSet(value, &options->views)) {
+        cerr << "Unknown set of views: " << value << endl;
+        return false;
+      }
+    } else if (strcmp(arg, "--view-count") == 0) {
+      if (!parsePositive(arg, value, &options->viewCount)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--view-spacing") == 0) {
+      if (!parsePositiveFloat(arg, value, &options->viewSpacing)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--light-cache") == 0) {
+      if (!parsePositiveFloat(arg, value, &options->lightCacheSpacing)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--photons") == 0) {
+      if (!parsePositive(arg, value, &options->photons)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--reference") == 0 && value != NULL) {
+      options->referenceFile = value;
+    } else if (strcmp(arg, "--tolerance") == 0) {
+      if (!parseNonNegative(arg, value, &options->tolerance)) {
+        return false;
+      }
+    } else if (strcmp(arg, "--heatmap") == 0 && value != NULL) {
+      options->heatmapFile = value;
+    } else if (strcmp(arg, "--timeline") == 0 && value != NULL) {
+      options->timelineFile = value;
+    } else {
+      cerr << "Unknown or incomplete option: " << arg << endl;
+      return false;
+    }
+    i++;
+  }
+
+  if (options->outputFile != NULL && strcmp(options->outputFile, "-") == 0) {
+    options->stream = true;
+  }
+  if (options->russianRoulette && options->minContribution == 0) {
+    cerr << "--roulette needs --min-contribution" << endl;
+    return false;
+  }
+  if (options->workers > 0 && (options->threads > 1 || options->pinThreads)) {
+    cerr << "--threads and --pin can't be combined with --workers" << endl;
+    return false;
+  }
+  if (options->isaForced && !options->fastMath) {
+    cerr << "Only the --fast-math lighting has a kernel per instruction set, "
+            "so --isa needs --fast-math"
+         << endl;
+    return false;
+  }
+  if (options->workers > 0 && (options->animate || options->frames > 1)) {
+    cerr << "Workers trace the scene at rest, so --animate and --frames "
+            "can't be combined with --workers"
+         << endl;
+    return false;
+  }
+  if (options->serveSocket != NULL &&
+      (options->workers > 0 || options->animate || options->rasterPrimary ||
+       options->pinThreads)) {
+    cerr << "--serve can't be combined with --workers, --animate, "
+            "--raster-primary or --pin"
+         << endl;
+    return false;
+  }
+  if (options->budgetMs > 0 &&
+      (options->workers > 0 || options->threads > 1 || options->pinThreads ||
+       options->stream || options->animate || options->frames > 1 ||
+       options->rasterPrimary)) {
+    cerr << "--budget traces one frame on one thread, so it can't be combined "
+            "with --workers, --threads, --pin, --stream, --animate, --frames "
+            "or --raster-primary"
+         << endl;
+    return false;
+  }
+  if (options->sharedName != NULL &&
+      (options->serveSocket != NULL || options->workerSocket != NULL)) {
+    cerr << "--shared publishes the window or a headless render, so it "
+            "can't be combined with --serve or --worker"
+         << endl;
+    return false;
+  }
+  if (options->views != VIEWS_SINGLE &&
+      (options->outputFile == NULL || options->stream ||
+       options->budgetMs > 0 || options->referenceFile != NULL ||
+       options->sharedName != NULL || options->animate ||
+       options->frames > 1)) {
+    cerr << "--views writes one image file per view, so it needs --output FILE "
+            "and can't be combined with --stream, --budget, --reference, "
+            "--shared, --animate or --frames"
+         << endl;
+    return false;
+  }
+  if ((options->tolerance >= 0 || options->heatmapFile != NULL) &&
+      options->referenceFile == NULL) {
+    cerr << "--tolerance and --heatmap need --reference" << endl;
+    return false;
+  }
+  if (options->stream && options->referenceFile != NULL) {
+    cerr << "--reference needs the whole image, so it can't be streamed"
+         << endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Prints the supported command line options.
+ *
+ * @param program The name the program was run with.
+ */
+void printUsage(const char *program) {
+  cerr << "Usage: " << program << " [options]\n"
+       << "  --output FILE    render without a window and write a PPM image,\n"
+       << "                   or - for standard output (implies --stream)\n"
+       << "  --stream         write the image row by row as tiles finish,\n"
+       << "                   holding only unfinished rows in memory\n"
+       << "  --size N         cells along x and y (default 500)\n"
+       << "  --samples N      samples per cell (default 4)\n"
+       << "  --sampler NAME   grid, sobol or halton placement of the samples\n"
+       << "                   of each cell (default grid)\n"
+       << "  --light-radius R trace soft shadows of lights with radius R\n"
+       << "  --no-shadows     trace no shadow rays, lighting every point\n"
+       << "                   that faces a light\n"
+       << "  --gloss G        spread reflections over a disk of radius G one\n"
+       << "                   unit along the mirror direction\n"
+       << "  --max-depth N    most levels of recursion (default 5)\n"
+       << "  --min-contribution T\n"
+       << "                   skip secondary rays adding less than T of their\n"
+       << "                   sample's color\n"
+       << "  --roulette       keep some rays below T at random, weighted up\n"
+       << "                   so the image stays unbiased\n"
+       << "  --tile N         tile size in cells (default 32)\n"
+       << "  --order NAME     trace cells in scanline, tiled, morton or\n"
+       << "                   hilbert order (default tiled)\n"
+       << "  --threads N      trace tiles on N threads (default 1)\n"
+       << "  --pin            bind each thread to a CPU of its NUMA node\n"
+       << "  --workers N      distribute tiles across N worker processes\n"
+       << "  --socket PATH    socket the coordinator listens on for workers\n"
+       << "  --worker PATH    serve tiles for the coordinator at PATH, which\n"
+       << "                   only accepts workers given the same options\n"
+       << "  --serve PATH     serve render jobs on the socket PATH, or on\n"
+       << "                   standard input for -, keeping the scene built\n"
+       << "                   between jobs; --threads sets the pool size\n"
+       << "  --fast-math      shade with fast approximations of pow, atan2,\n"
+       << "                   asin and 1/sqrt (workers need the same flag)\n"
+       << "  --isa NAME       use the generic, sse4, avx2 or avx512 fast-math\n"
+       << "                   lighting kernels rather than the best the\n"
+       << "                   processor supports (needs --fast-math)\n"
+       << "  --scene NAME     default, or crates for a field of instanced\n"
+       << "                   crates, or mirrors for facing mirrors along the\n"
+       << "                   floor (workers need the same flag)\n"
+       << "  --animate        move the earth and the cylinder; p pauses\n"
+       << "  --frames N       trace N frames of the animation, 1/30 s apart,\n"
+       << "                   and write the last\n"
+       << "  --budget MS      write the image within MS milliseconds, at the\n"
+       << "                   best quality up to the other options it allows\n"
+       << "  --shared NAME    publish frames in POSIX shared memory as they\n"
+       << "                   are traced, e.g. /raytracer\n"
+       << "  --views NAME     trace stereo, cubemap or array views of the\n"
+       << "                   scene in one run, writing FILE-NAME.ppm each\n"
+       << "  --view-count N   cameras in an array (default 3)\n"
+       << "  --view-spacing D distance between stereo eyes or array\n"
+       << "                   cameras (default 1)\n"
+       << "  --raster-primary find primary hits from a per-cell list of\n"
+       << "                   objects, made by projecting their bounds\n"
+       << "  --light-cache R  reuse shadow results of nearby points within R\n"
+       << "                   world units, away from shadow edges\n"
+       << "  --reference FILE compare a headless render with a PPM image\n"
+       << "  --tolerance N    fail if any channel differs from the reference\n"
+       << "                   by more than N\n"
+       << "  --heatmap FILE   write where the render differs from the\n"
+       << "                   reference to FILE when it fails --tolerance\n"
+       << "  --timeline FILE  write a Chrome trace of the render's phases\n"
+       << "  --photons N      trace N photons per light through each\n"
+       << "                   refractive or transparent object for caustics\n";
+}
+
+/**
+ * @brief Describes every option which changes how a tile is traced, other than
+ * those sent with each tile. A coordinator only accepts workers whose
+ * description matches its own, so that every tile of an image is traced the
+ * same way.
+ *
+ * @param options
+ * @return std::string
+ */
+string describeRenderSettings(const Options &options) {
+  const char *patterns[] = {"grid", "sobol", "halton"};
+  ostringstream out;
+  out << setprecision(9) << "scene=" << options.scene
+      << " sampler=" << patterns[options.samplePattern]
+      << " light-radius=" << options.lightRadius
+      << " shadows=" << options.shadows
+      << " gloss=" << options.glossiness << " max-depth=" << options.maxDepth
+      << " min-contribution=" << options.minContribution
+      << " roulette=" << options.russianRoulette
+      << " photons=" << options.photons
+      << " light-cache=" << options.lightCacheSpacing
+      << " raster-primary=" << options.rasterPrimary
+      << " animate=" << options.animate
+      << " fast-math=" << options.fastMath;
+  return out.str();
+}
@@ -0,0 +1,268 @@
+#ifndef H_OPTIONS
+#define H_OPTIONS
+
+#include "CpuDispatch.h"
+#include "Sampler.h"
+#include "Tile.h"
+#include "Views.h"
+#include <string>
+
+/**
+ * @brief Settings given on the command line. Without any options, the ray
+ * tracer opens an interactive GLUT window.
+ *
+ */
+struct Options {
+  /**
+   * @brief If set, the image is rendered without a window and written to this
+   * PPM file, or to standard output if it is "-".
+   *
+   */
+  const char *outputFile;
+
+  /**
+   * @brief Whether the image is written row by row as it is traced, rather
+   * than once it is complete. Always the case when writing to standard output.
+   *
+   */
+  bool stream;
+
+  /**
+   * @brief The number of cells along x and y for headless renders.
+   *
+   */
+  int divisions;
+
+  /**
+   * @brief The number of samples per cell for headless renders.
+   *
+   */
+  int samples;
+
+  /**
+   * @brief How the samples of each cell are placed.
+   *
+   */
+  SamplePattern samplePattern;
+
+  /**
+   * @brief The radius of the lights, or 0 for point lights with hard shadows.
+   *
+   */
+  float lightRadius;
+
+  /**
+   * @brief Whether shadow rays are traced. Without them, every light reaches
+   * every point which faces it.
+   *
+   */
+  bool shadows;
+
+  /**
+   * @brief How far reflections are spread around the mirror direction, or 0
+   * for mirror reflections.
+   *
+   */
+  float glossiness;
+
+  /**
+   * @brief The most levels of recursion of a ray.
+   *
+   */
+  int maxDepth;
+
+  /**
+   * @brief The fraction of a sample's color below which secondary rays are
+   * not traced, or 0 to trace them all up to `maxDepth`.
+   *
+   */
+  float minContribution;
+
+  /**
+   * @brief Whether secondary rays below `minContribution` are kept at random
+   * with Russian roulette, rather than always cut off.
+   *
+   */
+  bool russianRoulette;
+
+  /**
+   * @brief The width and height of the tiles an image is split into.
+   *
+   */
+  int tileSize;
+
+  /**
+   * @brief The order the cells of a headless render are traced in.
+   *
+   */
+  TileOrder order;
+
+  /**
+   * @brief The number of threads tracing a headless render in-process.
+   *
+   */
+  int threads;
+
+  /**
+   * @brief Whether each of the `threads` is bound to one CPU of its NUMA node.
+   *
+   */
+  bool pinThreads;
+
+  /**
+   * @brief The number of local worker processes a headless render is
+   * distributed across. With zero workers, the image is traced in-process.
+   *
+   */
+  int workers;
+
+  /**
+   * @brief The Unix domain socket the coordinator listens on for workers.
+   *
+   */
+  const char *socketPath;
+
+  /**
+   * @brief If set, the process runs as a worker, serving tiles for the
+   * coordinator listening on this socket.
+   *
+   */
+  const char *workerSocket;
+
+  /**
+   * @brief If set, the process runs as a render server, taking jobs from this
+   * Unix domain socket, or from standard input if it is "-".
+   *
+   */
+  const char *serveSocket;
+
+  /**
+   * @brief Whether shading uses the fast approximations in FastMath.h rather
+   * than the standard library.
+   *
+   */
+  bool fastMath;
+
+  /**
+   * @brief Whether `isa` was given. Otherwise the best instruction set the
+   * processor supports is used.
+   *
+   */
+  bool isaForced;
+
+  /**
+   * @brief The instruction set whose kernels are used, if `isaForced`.
+   *
+   */
+  IsaLevel isa;
+
+  /**
+   * @brief The scene to render: "default", "crates" or "mirrors".
+   *
+   */
+  const char *scene;
+
+  /**
+   * @brief Whether the earth and the cylinder move.
+   *
+   */
+  bool animate;
+
+  /**
+   * @brief The number of frames of the animation a headless render traces,
+   * 1/30 s apart. Only the last frame is written.
+   *
+   */
+  int frames;
+
+  /**
+   * @brief If positive, a headless render is written within this many
+   * milliseconds, at the best quality up to the other options it can afford.
+   *
+   */
+  float budgetMs;
+
+  /**
+   * @brief If set, frames are published in POSIX shared memory under this
+   * name, such as "/raytracer", as they are traced.
+   *
+   */
+  const char *sharedName;
+
+  /**
+   * @brief The views a headless render traces of the scene, each written to
+   * its own image named after `outputFile`.
+   *
+   */
+  ViewSet views;
+
+  /**
+   * @brief The number of cameras in an array of views.
+   *
+   */
+  int viewCount;
+
+  /**
+   * @brief The distance between stereo eyes, or neighbouring cameras of an
+   * array, in world units.
+   *
+   */
+  float viewSpacing;
+
+  /**
+   * @brief Whether primary rays only test the objects whose projected bounds
+   * cover their cell.
+   *
+   */
+  bool rasterPrimary;
+
+  /**
+   * @brief The radius in world units over which cached shadow results are
+   * reused, or 0 to trace every shadow ray.
+   *
+   */
+  float lightCacheSpacing;
+
+  /**
+   * @brief If set, a headless render is compared with this PPM image.
+   *
+   */
+  const char *referenceFile;
+
+  /**
+   * @brief The largest difference of a channel from `referenceFile` which is
+   * accepted, or -1 to only report the difference. When a pixel differs by
+   * more, the render fails.
+   *
+   */
+  int tolerance;
+
+  /**
+   * @brief If set, a heatmap of where the render differs from
+   * `referenceFile` is written to this PPM file when it fails `tolerance`.
+   *
+   */
+  const char *heatmapFile;
+
+  /**
+   * @brief If set, the render's timeline of zones is written to this Chrome
+   * trace file when the program finishes.
+   *
+   */
+  const char *timelineFile;
+
+  /**
+   * @brief The number of photons aimed from each light at each refractive or
+   * transparent object to find their caustics, or 0 to approximate them.
+   *
+   */
+  int photons;
+};
+
+bool parseOptions(int argc, char *argv[], Options *options);
+
+void printUsage(const char *program);
+
+std::string describeRenderSettings(const Options &options);
+
+#endif //! H_OPTIONS
@@ -0,0 +1,136 @@
+#include "PPMStream.h"
+#include "Framebuffer.h"
+#include <iostream>
+#include <string.h>
+
+using namespace std;
+
+/**
+ * @brief Creates a stream for an image of the given size, traced in tiles
+ * which cover every cell exactly once.
+ *
+ * @param w The width of the image, in cells.
+ * @param h The height of the image, in cells.
+ */
+PPMStream::PPMStream(int w, int h)
+    : file(NULL), ownsFile(false), width(w), height(h), nextRow(h - 1),
+      heldBytes(0), peakHeldBytes(0), failed(false) {}
+
+PPMStream::~PPMStream() {
+  if (ownsFile) {
+    fclose(file);
+  }
+}
+
+/**
+ * @brief Opens the output and writes the PPM header, so a reader at the other
+ * end of a pipe can start straight away.
+ *
+ * @param filename The file to write, or "-" for standard output.
+ * @return true The header was written.
+ * @return false The file could not be opened or written.
+ */
+bool PPMStream::open(const char *filename) {
+  if (strcmp(filename, "-") == 0) {
+    file = stdout;
+  } else {
+    file = fopen(filename, "wb");
+    ownsFile = file != NULL;
+  }
+  if (file == NULL) {
+    cerr << "*** Error opening output file: " << filename << endl;
+    return false;
+  }
+
+  fprintf(file, "P6\n%d %d\n255\n", width, height);
+  // Flush before any workers are forked, so they don't inherit the header
+  failed = fflush(file) != 0;
+  return !failed;
+}
+
+/**
+ * @brief Converts a traced tile to bytes and holds it until its rows are
+ * complete, then writes every row that is ready.
+ *
+ * @param tile The tile's position and size.
+ * @param tilePixels The tile's pixels, stored row by row from the bottom row.
+ */
+void PPMStream::setTile(const Tile &tile, const glm::vec3 *tilePixels) {
+  HeldTile heldTile;
+  heldTile.tile = tile;
+  heldTile.bytes.resize(tile.width * tile.height * 3);
+  for (int i = 0; i < tile.width * tile.height; i++) {
+    heldTile.bytes[i * 3] = toByte(tilePixels[i].r);
+    heldTile.bytes[i * 3 + 1] = toByte(tilePixels[i].g);
+    heldTile.bytes[i * 3 + 2] = toByte(tilePixels[i].b);
+  }
+  heldBytes += heldTile.bytes.size();
+  if (heldBytes > peakHeldBytes) {
+    peakHeldBytes = heldBytes;
+  }
+  held.push_back(heldTile);
+
+  if (!failed && !writeReadyRows()) {
+    cerr << "*** Error writing the output image" << endl;
+    failed = true;
+  }
+}
+
+/**
+ * @brief Writes rows from the top down for as long as the next row has all of
+ * its tiles, and releases the tiles whose rows have all been written.
+ *
+ * @return true Every ready row was written.
+ * @return false The output could not be written.
+ */
+bool PPMStream::writeReadyRows() {
+  vector<const HeldTile *> row(width);
+  int firstRow = nextRow;
+  while (nextRow >= 0) {
+    // Index the row's tiles by the cells they cover, so it is written left to
+    // right
+    int covered = 0;
+    for (size_t t = 0; t < held.size(); t++) {
+      const Tile &tile = held[t].tile;
+      if (tile.y <= nextRow && nextRow < tile.y + tile.height) {
+        row[tile.x] = &held[t];
+        covered += tile.width;
+      }
+    }
+    if (covered < width) {
+      break;
+    }
+
+    for (int x = 0; x < width; x += row[x]->tile.width) {
+      const HeldTile &tile = *row[x];
+      int j = nextRow - tile.tile.y;
+      const unsigned char *bytes = &tile.bytes[j * tile.tile.width * 3];
+      if (fwrite(bytes, 3, tile.tile.width, file) != (size_t)tile.tile.width) {
+        return false;
+      }
+    }
+    nextRow--;
+
+    for (size_t t = held.size(); t-- > 0;) {
+      if (held[t].tile.y > nextRow) {
+        heldBytes -= held[t].bytes.size();
+        held.erase(held.begin() + t);
+      }
+    }
+  }
+  return nextRow == firstRow || fflush(file) == 0;
+}
+
+/**
+ * @brief Checks that the whole image has been written.
+ *
+ * @return true Every row was written.
+ * @return false A write failed, or some tiles never arrived.
+ */
+bool PPMStream::finish() {
+  if (!failed && nextRow >= 0) {
+    cerr << "*** Output image is missing " << nextRow + 1 << " rows" << endl;
+    failed = true;
+  }
+  return !failed;
+}
@@ -0,0 +1,55 @@
+#ifndef H_PPM_STREAM
+#define H_PPM_STREAM
+
+#include "TileSink.h"
+#include <stdio.h>
+#include <vector>
+
+/**
+ * @brief Writes a binary PPM (P6) image while it is being traced, without
+ * holding the whole image in memory.
+ *
+ * PPM stores the top row first, so the image is written row by row from the
+ * top down. A row is written as soon as every tile covering it has arrived,
+ * and a tile is held until its bottom row has been written. Tiles may be of
+ * any size and arrive in any order, but when they are traced from the top
+ * down, only the tiles in flight are ever held.
+ */
+class PPMStream : public TileSink {
+private:
+  struct HeldTile {
+    Tile tile;
+    std::vector<unsigned char> bytes; // Row by row from the bottom row
+  };
+
+  FILE *file;
+  bool ownsFile;
+  int width;
+  int height;
+  int nextRow; // The next row to be written
+  std::vector<HeldTile> held;
+  size_t heldBytes;
+  size_t peakHeldBytes;
+  bool failed;
+
+  bool writeReadyRows();
+
+public:
+  PPMStream(int w, int h);
+  ~PPMStream();
+
+  bool open(const char *filename);
+
+  void setTile(const Tile &tile, const glm::vec3 *tilePixels);
+
+  bool finish();
+
+  /**
+   * @brief The most pixel data held at once while waiting for rows to
+   * complete, in bytes.
+   *
+   */
+  size_t peakBytes() const { return peakHeldBytes; }
+};
+
+#endif //! H_PPM_STREAM
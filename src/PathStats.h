@@ -0,0 +1,53 @@
+#ifndef H_PATH_STATS
+#define H_PATH_STATS
+
+#include <ostream>
+#include <stddef.h>
+
+/**
+ * @brief Counts what happened to the secondary rays (reflected, refracted and
+ * transparent) that shading wanted to trace. Each thread keeps its own counts.
+ *
+ */
+class PathStats {
+private:
+  size_t traced;      // Secondary rays traced at full weight
+  size_t survived;    // Secondary rays kept by Russian roulette
+  size_t cut;         // Secondary rays whose contribution was too small
+  size_t depthCapped; // Secondary rays beyond the depth cap
+
+public:
+  PathStats() : traced(0), survived(0), cut(0), depthCapped(0) {}
+
+  void trace() { traced++; }
+
+  void survive() { survived++; }
+
+  void cutOff() { cut++; }
+
+  void capDepth() { depthCapped++; }
+
+  void clearStats() {
+    traced = 0;
+    survived = 0;
+    cut = 0;
+    depthCapped = 0;
+  }
+
+  /**
+   * @brief Prints how many secondary rays were traced, and how many were saved
+   * by their contribution being too small.
+   *
+   */
+  void report(std::ostream &out) const {
+    size_t total = traced + survived + cut;
+    out << "  " << traced << " traced, " << survived
+        << " kept by Russian roulette, " << cut << " cut off";
+    if (total > 0) {
+      out << " (" << 100.0 * cut / total << "% saved)";
+    }
+    out << ", " << depthCapped << " stopped at the depth cap\n";
+  }
+};
+
+#endif //! H_PATH_STATS
@@ -0,0 +1,116 @@
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef __linux__
+/**
+ * @brief Opens a disabled counter for this process and the threads it starts.
+ *
+ * @param type
+ * @param config
+ * @return int The counter's file descriptor, or -1 if it is not available.
+ */
+static int openCounter(uint32_t type, uint64_t config) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+PerfCounters::PerfCounters() {
+  for (int i = 0; i < COUNTERS; i++) {
+    fds[i] = -1;
+    values[i] = 0;
+  }
+#ifdef __linux__
+  fds[CACHE_REFERENCES] =
+      openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+  fds[CACHE_MISSES] =
+      openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  fds[TASK_CLOCK] = openCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (int i = 0; i < COUNTERS; i++) {
+    if (fds[i] >= 0) {
+      close(fds[i]);
+    }
+  }
+#endif
+}
+
+/**
+ * @brief Resets the counters and starts counting.
+ *
+ */
+void PerfCounters::start() {
+#ifdef __linux__
+  for (int i = 0; i < COUNTERS; i++) {
+    if (fds[i] >= 0) {
+      ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+/**
+ * @brief Stops counting and reads the counts. Threads started since `start()`
+ * must have been joined for their counts to be included.
+ *
+ */
+void PerfCounters::stop() {
+#ifdef __linux__
+  for (int i = 0; i < COUNTERS; i++) {
+    if (fds[i] >= 0) {
+      ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) {
+        values[i] = 0;
+      }
+    }
+  }
+#endif
+}
+
+/**
+ * @brief Prints the counts, and the fraction of cache references that missed.
+ *
+ */
+void PerfCounters::report(ostream &out) const {
+  out << "  CPU time: ";
+  if (fds[TASK_CLOCK] >= 0) {
+    out << values[TASK_CLOCK] / 1e6 << " ms\n";
+  } else {
+    out << "unavailable\n";
+  }
+
+  out << "  Cache misses: ";
+  if (fds[CACHE_REFERENCES] >= 0 && fds[CACHE_MISSES] >= 0) {
+    out << values[CACHE_MISSES] << " of " << values[CACHE_REFERENCES]
+        << " references";
+    if (values[CACHE_REFERENCES] > 0) {
+      out << " (" << 100.0 * values[CACHE_MISSES] / values[CACHE_REFERENCES]
+          << "%)";
+    }
+    out << "\n";
+  } else {
+    out << "unavailable\n";
+  }
+}
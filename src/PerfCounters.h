@@ -0,0 +1,37 @@
+#ifndef H_PERF_COUNTERS
+#define H_PERF_COUNTERS
+
+#include <ostream>
+#include <stdint.h>
+
+/**
+ * @brief Counts cache references, cache misses and CPU time over a stretch of
+ * the program with Linux perf events. The counts include threads started
+ * while counting, once they have exited.
+ *
+ * Counters the kernel or processor does not provide (for example inside some
+ * virtual machines, or when `perf_event_paranoid` forbids them) are reported
+ * as unavailable rather than failing the render.
+ */
+class PerfCounters {
+private:
+  enum { CACHE_REFERENCES, CACHE_MISSES, TASK_CLOCK, COUNTERS };
+
+  int fds[COUNTERS];
+  uint64_t values[COUNTERS];
+
+public:
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  void start();
+
+  void stop();
+
+  void report(std::ostream &out) const;
+};
+
+#endif //! H_PERF_COUNTERS
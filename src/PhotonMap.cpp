@@ -0,0 +1,317 @@
+#include "PhotonMap.h"
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+// The number of photons traced by one task. Each task seeds its own random
+// numbers from its index, so the map does not depend on the number of threads
+const int PHOTON_CHUNK = 4096;
+
+// The most surfaces a photon passes through before it is dropped
+const int MAX_PHOTON_STEPS = 5;
+
+/**
+ * @brief A batch of photons aimed from one light at one object.
+ *
+ */
+struct PhotonChunk {
+  glm::vec3 light;
+  int target;
+  int first; // The index of the chunk's first photon aimed at the target
+  int count;
+};
+
+/**
+ * @brief Returns the number of threads the map is built with.
+ *
+ * @return int
+ */
+static int photonThreads() {
+  unsigned count = thread::hardware_concurrency();
+  return count == 0 ? 1 : (int)count;
+}
+
+/**
+ * @brief Runs `task(i)` for every i in [0, count), spread over threads.
+ *
+ */
+template <class Task> static void runParallel(int count, int threads,
+                                              Task task) {
+  atomic<int> next(0);
+  auto work = [&]() {
+    for (int i = next++; i < count; i = next++) {
+      task(i);
+    }
+  };
+  vector<thread> pool;
+  for (int t = 1; t < min(threads, count); t++) {
+    pool.push_back(thread(work));
+  }
+  work();
+  for (size_t t = 0; t < pool.size(); t++) {
+    pool[t].join();
+  }
+}
+
+/**
+ * @brief Traces one photon through refractive and transparent objects, and
+ * stores it where it lands on any other surface.
+ *
+ * @param objects
+ * @param bvh
+ * @param ray The photon's path from the light.
+ * @param power
+ * @param optics
+ * @param landed Receives where the photon landed.
+ * @param landedObject Receives the index of the object it landed on.
+ * @param landedPower Receives its power after passing through objects.
+ * @return true The photon passed through at least one object and landed.
+ */
+static bool tracePhoton(const vector<SceneObject *> &objects, const BVH &bvh,
+                        Ray ray, glm::vec3 power, const PhotonOptics &optics,
+                        glm::vec3 *landed, int *landedObject,
+                        glm::vec3 *landedPower) {
+  bool transmitted = false;
+  for (int step = 0; step < MAX_PHOTON_STEPS; step++) {
+    Hit hit = bvh.closestHit(ray, objects);
+    if (hit.index == -1) {
+      return false;
+    }
+    SceneObject *object = objects[hit.index];
+    glm::vec3 point = ray.at(hit.t);
+
+    if (object->isRefractive()) {
+      // Passes into the object and out the other side, like a refracted ray
+      glm::vec3 n = object->normalOfPart(point, hit.part);
+      glm::vec3 g = glm::refract(ray.dir, n, optics.eta);
+      Ray inside(point, g);
+      Hit exit = bvh.closestHit(inside, objects);
+      if (exit.index == -1) {
+        return false;
+      }
+      glm::vec3 exitPt = inside.at(exit.t);
+      glm::vec3 m = objects[exit.index]->normalOfPart(exitPt, exit.part);
+      glm::vec3 h = glm::refract(g, -m, 1.0f / optics.eta);
+      if (glm::dot(h, h) == 0) {
+        return false; // Total internal reflection
+      }
+      power *= object->getColor() * optics.transmission;
+      ray = Ray(exitPt, h);
+      transmitted = true;
+    } else if (object->isTransparent()) {
+      power *= object->getColor() * optics.transmission;
+      ray = Ray(point, ray.dir);
+      transmitted = true;
+    } else {
+      // Light reaching a surface directly is already shaded by `trace`
+      if (!transmitted) {
+        return false;
+      }
+      *landed = point;
+      *landedObject = hit.index;
+      *landedPower = power;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Traces photons from every light through every refractive or
+ * transparent object, and builds the grid used to look them up. Photons are
+ * aimed at a disc covering the object's bounds, as seen from the light, so
+ * none are wasted on the rest of the scene.
+ *
+ * @param objects The scene objects.
+ * @param bvh The acceleration structure over `objects`.
+ * @param lights The positions of the lights.
+ * @param lightCount
+ * @param photonsPerLight The photons aimed from each light at each object.
+ * @param gatherRadius How far from a point photons are counted, in world
+ * units.
+ * @param optics
+ */
+void PhotonMap::build(const vector<SceneObject *> &objects, const BVH &bvh,
+                      const glm::vec3 *lights, int lightCount,
+                      int photonsPerLight, float gatherRadius,
+                      const PhotonOptics &optics) {
+  clear();
+  radius = gatherRadius;
+  cellSize = 2 * gatherRadius;
+
+  vector<PhotonChunk> chunks;
+  for (int l = 0; l < lightCount; l++) {
+    for (size_t i = 0; i < objects.size(); i++) {
+      if (!objects[i]->isRefractive() && !objects[i]->isTransparent()) {
+        continue;
+      }
+      for (int first = 0; first < photonsPerLight; first += PHOTON_CHUNK) {
+        PhotonChunk chunk = {lights[l], (int)i, first,
+                             min(PHOTON_CHUNK, photonsPerLight - first)};
+        chunks.push_back(chunk);
+      }
+    }
+  }
+
+  int threads = photonThreads();
+  vector<vector<Photon>> landed(chunks.size());
+  runParallel((int)chunks.size(), threads, [&](int c) {
+    const PhotonChunk &chunk = chunks[c];
+    AABB box = objects[chunk.target]->bounds();
+    glm::vec3 center = box.center();
+    float discRadius = glm::length(box.hi - center);
+
+    // The disc faces the light, and each photon carries an equal share of the
+    // light falling on it
+    glm::vec3 axis = glm::normalize(center - chunk.light);
+    glm::vec3 helper =
+        fabs(axis.y) < 0.9f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+    glm::vec3 u = glm::normalize(glm::cross(axis, helper));
+    glm::vec3 v = glm::cross(axis, u);
+    glm::vec3 power(M_PI * discRadius * discRadius / photonsPerLight);
+
+    mt19937 random(c);
+    uniform_real_distribution<float> uniform(0, 1);
+    for (int p = 0; p < chunk.count; p++) {
+      float r = discRadius * sqrtf(uniform(random));
+      float angle = 2 * M_PI * uniform(random);
+      glm::vec3 target = center + u * (r * cosf(angle)) + v * (r * sinf(angle));
+
+      Photon photon;
+      Ray ray(chunk.light, glm::normalize(target - chunk.light));
+      if (tracePhoton(objects, bvh, ray, power, optics, &photon.point,
+                      &photon.object, &photon.power)) {
+        landed[c].push_back(photon);
+      }
+    }
+  });
+
+  for (size_t c = 0; c < landed.size(); c++) {
+    photons.insert(photons.end(), landed[c].begin(), landed[c].end());
+  }
+  buildGrid(threads);
+}
+
+/**
+ * @brief Removes every photon.
+ *
+ */
+void PhotonMap::clear() {
+  photons.clear();
+  bucketStart.clear();
+}
+
+size_t PhotonMap::bucketOf(int x, int y, int z) const {
+  unsigned hash = (unsigned)x * 73856093u ^ (unsigned)y * 19349663u ^
+                  (unsigned)z * 83492791u;
+  return hash & (bucketStart.size() - 2);
+}
+
+size_t PhotonMap::bucketOf(glm::vec3 point) const {
+  glm::vec3 cell = point / cellSize;
+  return bucketOf((int)floorf(cell.x), (int)floorf(cell.y),
+                  (int)floorf(cell.z));
+}
+
+/**
+ * @brief Sorts the photons by bucket with a counting sort. Each thread counts
+ * and then places the photons of its own slice.
+ *
+ * @param threads
+ */
+void PhotonMap::buildGrid(int threads) {
+  size_t buckets = 1024;
+  while (buckets < photons.size() / 2) {
+    buckets *= 2;
+  }
+  // One more entry marks the end of the last bucket, and keeps the size of
+  // the table, less two, usable as a mask
+  bucketStart.assign(buckets + 1, 0);
+
+  int slices = threads;
+  size_t sliceSize = (photons.size() + slices - 1) / slices;
+  vector<vector<int>> counts(slices, vector<int>(buckets, 0));
+  vector<unsigned> photonBucket(photons.size());
+
+  runParallel(slices, threads, [&](int s) {
+    size_t end = min(photons.size(), (s + 1) * sliceSize);
+    for (size_t i = s * sliceSize; i < end; i++) {
+      photonBucket[i] = bucketOf(photons[i].point);
+      counts[s][photonBucket[i]]++;
+    }
+  });
+
+  // Turn the counts into where each slice starts writing in each bucket
+  int offset = 0;
+  for (size_t b = 0; b < buckets; b++) {
+    bucketStart[b] = offset;
+    for (int s = 0; s < slices; s++) {
+      int count = counts[s][b];
+      counts[s][b] = offset;
+      offset += count;
+    }
+  }
+  bucketStart[buckets] = offset;
+
+  vector<Photon> sorted(photons.size());
+  runParallel(slices, threads, [&](int s) {
+    size_t end = min(photons.size(), (s + 1) * sliceSize);
+    for (size_t i = s * sliceSize; i < end; i++) {
+      sorted[counts[s][photonBucket[i]]++] = photons[i];
+    }
+  });
+  photons.swap(sorted);
+}
+
+/**
+ * @brief Estimates the light arriving at a point through refractive and
+ * transparent objects, from the density of photons around it.
+ *
+ * @param object The index of the object the point is on. Only photons which
+ * landed on the same object are counted, so light does not leak between
+ * nearby surfaces.
+ * @param point
+ * @return glm::vec3 The irradiance, to be multiplied by the surface's color.
+ */
+glm::vec3 PhotonMap::irradiance(int object, glm::vec3 point) const {
+  glm::vec3 total(0);
+  if (photons.empty()) {
+    return total;
+  }
+
+  glm::vec3 scaled = point / cellSize;
+  int base[3];
+  for (int axis = 0; axis < 3; axis++) {
+    float cell = floorf(scaled[axis]);
+    base[axis] = (int)cell - (scaled[axis] - cell < 0.5f ? 1 : 0);
+  }
+
+  // Neighbouring cells can share a bucket, which must only be counted once
+  size_t visited[8];
+  int visitedCount = 0;
+  float radiusSquared = radius * radius;
+  for (int corner = 0; corner < 8; corner++) {
+    size_t bucket = bucketOf(base[0] + (corner & 1),
+                             base[1] + (corner >> 1 & 1),
+                             base[2] + (corner >> 2));
+    if (find(visited, visited + visitedCount, bucket) !=
+        visited + visitedCount) {
+      continue;
+    }
+    visited[visitedCount++] = bucket;
+
+    for (int i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++) {
+      const Photon &photon = photons[i];
+      glm::vec3 offset = photon.point - point;
+      if (photon.object == object &&
+          glm::dot(offset, offset) <= radiusSquared) {
+        total += photon.power;
+      }
+    }
+  }
+  return total / (float)(M_PI * radiusSquared);
+}
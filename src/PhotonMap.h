@@ -0,0 +1,63 @@
+#ifndef H_PHOTON_MAP
+#define H_PHOTON_MAP
+
+#include "BVH.h"
+#include "SceneObject.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+/**
+ * @brief How light passes through refractive and transparent objects, which
+ * should match how `trace` shades them.
+ *
+ */
+struct PhotonOptics {
+  float eta;          // The ratio of refractive indices when entering
+  float transmission; // The fraction of light passing through a surface
+};
+
+/**
+ * @brief Caustics cast by refractive and transparent objects, found by tracing
+ * photons from the lights through those objects. Photons which then land on
+ * another surface are stored in a hash grid, and the light arriving at a
+ * point is estimated from the photons stored around it.
+ *
+ * Lights are treated like the rest of the ray tracer treats them: they light
+ * a surface facing them with unit intensity, however far away it is.
+ *
+ */
+class PhotonMap {
+private:
+  struct Photon {
+    glm::vec3 point;
+    glm::vec3 power;
+    int object; // The object the photon landed on
+  };
+
+  float radius;
+  float cellSize;
+  std::vector<Photon> photons;
+  std::vector<int> bucketStart; // Photons of bucket b are from bucketStart[b]
+                                // up to bucketStart[b + 1]
+
+  size_t bucketOf(int x, int y, int z) const;
+  size_t bucketOf(glm::vec3 point) const;
+  void buildGrid(int threads);
+
+public:
+  PhotonMap() : radius(0), cellSize(0) {}
+
+  void build(const std::vector<SceneObject *> &objects, const BVH &bvh,
+             const glm::vec3 *lights, int lightCount, int photonsPerLight,
+             float gatherRadius, const PhotonOptics &optics);
+
+  void clear();
+
+  bool isEmpty() const { return photons.empty(); }
+
+  size_t size() const { return photons.size(); }
+
+  glm::vec3 irradiance(int object, glm::vec3 point) const;
+};
+
+#endif //! H_PHOTON_MAP
@@ -72,3 +72,17 @@ glm::vec3 Plane::normal(glm::vec3 pt) {
   n = glm::normalize(glm::cross(b - a, d - a));
   return n;
 }
+
+/**
+ * @brief Returns the box enclosing the four vertices.
+ *
+ * @return AABB
+ */
+AABB Plane::bounds() {
+  AABB box;
+  box.expand(a);
+  box.expand(b);
+  box.expand(c);
+  box.expand(d);
+  return box;
+}
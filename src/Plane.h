@@ -32,6 +32,8 @@ public:
 	
 	glm::vec3 normal(glm::vec3 pt);
 
+	AABB bounds();
+
 };
 
 #endif //!H_PLANE
@@ -12,25 +12,22 @@ void Ray::normalize()
    dir = glm::normalize(dir);
 }
 
-//Finds the closest point of intersection of the current ray with scene objects
-void Ray::closestPt(std::vector<SceneObject*> &sceneObjects)
+//Finds the closest intersection of the current ray with scene objects. Only
+//the distance and index are recorded; the point itself is left to the caller.
+Hit Ray::closestPt(const std::vector<SceneObject*> &sceneObjects) const
 {
-	glm::vec3 point(0,0,0);
-	float min = 1.e+6;
-    for(uint i = 0;  i < sceneObjects.size();  i++)
+	Hit hit;
+	hit.t = tmax;
+	for(uint i = 0;  i < sceneObjects.size();  i++)
 	{
-        float t = sceneObjects[i]->intersect(pt, dir);
-		if(t > 0)        //Intersects the object
+		int part;
+		float t = sceneObjects[i]->intersectPart(pt, dir, &part);
+		if(t > tmin && t < hit.t)	//Intersects the object
 		{
-			point = pt + dir*t;
-			if(t < min)
-			{
-				xpt = point;
-				xindex = i;
-				xdist = t;
-				min = t;
-			}
+			hit.t = t;
+			hit.index = i;
+			hit.part = part;
 		}
 	}
+	return hit;
 }
-
@@ -2,6 +2,10 @@
 * COSC363  Ray Tracer
 *
 *  The ray class
+*  A ray only stores what is needed to find intersections.
+*  The result of an intersection search is returned as a
+*  separate, smaller Hit record, and the point of
+*  intersection is only computed when it is shaded.
 -------------------------------------------------------------*/
 
 #ifndef H_RAY
@@ -10,39 +14,54 @@
 #include <vector>
 #include "SceneObject.h"
 
+// The furthest distance along a ray that intersections are searched for
+const float RAY_TMAX = 1.e+6;
+
+// Hits closer than this to the ray's source are ignored, so that rays leaving
+// a surface do not hit it again
+const float MIN_HIT_DISTANCE = 0.0001;
+
+/**
+ * @brief The closest intersection found along a ray.
+ *
+ */
+struct Hit
+{
+	float t;	//The distance from the ray's source to the intersection
+
+	// The index of the object that gives the closest point of intersection.
+	// -1 if the ray does not intersect any objects
+	int index;
+
+	// Which part of the object was hit, for objects made of several parts
+	int part;
+
+	Hit() : t(RAY_TMAX), index(-1), part(0) {}
+};
+
 class Ray
 {
 
 public:
-    glm::vec3 pt;	//The source point of the ray
+	glm::vec3 pt;	//The source point of the ray
 	glm::vec3 dir;	//The UNIT direction of the ray
-	glm::vec3 xpt;	//The closest point of intersection on the ray, if found
-	
-	// The index of the object that gives the closest point of intersection.
-	// -1 if the ray does not intersect any objects
-	int xindex;	
-	
-	float xdist;	//The distance from the source to xpt along the ray.
-
-    Ray()
-	{
-		pt = glm::vec3(0, 0, 0);
-		dir = glm::vec3(0, 0, -1);
-		xpt = glm::vec3(0, 0, 0);
-		xindex = -1;
-		xdist = 0;
-	}	;
-	
-    Ray(glm::vec3 point, glm::vec3 direction)
-		: pt(point), dir(direction)
-	{
-		xpt = glm::vec3(0, 0, 0);
-		xindex = -1;
-		xdist = 0;
-	} ;
-
-    void normalize();
-	void closestPt(std::vector<SceneObject*> &sceneObjects);
+
+	// Only intersections with tmin < t < tmax are reported
+	float tmin;
+	float tmax;
+
+	Ray()
+		: pt(glm::vec3(0, 0, 0)), dir(glm::vec3(0, 0, -1)), tmin(0),
+		  tmax(RAY_TMAX) {}
+
+	Ray(glm::vec3 point, glm::vec3 direction)
+		: pt(point), dir(direction), tmin(0), tmax(RAY_TMAX) {}
+
+	void normalize();
+	Hit closestPt(const std::vector<SceneObject*> &sceneObjects) const;
+
+	// The point at distance t along the ray
+	glm::vec3 at(float t) const { return pt + dir * t; }
 
 };
 #endif
@@ -1,16 +1,46 @@
+#include "AllocationCounter.h"
+#include "BVH.h"
+#include "Camera.h"
 #include "Cone.h"
 #include "Cube.h"
 #include "Cylinder.h"
+#include "Deadline.h"
+#include "Distributed.h"
+#include "DynamicResolution.h"
+#include "FastMath.h"
+#include "Framebuffer.h"
+#include "Instance.h"
+#include "Lighting.h"
+#include "LightingCache.h"
+#include "Options.h"
+#include "PathStats.h"
+#include "PPMStream.h"
+#include "PerfCounters.h"
+#include "PhotonMap.h"
 #include "Plane.h"
 #include "Ray.h"
+#include "RenderServer.h"
+#include "RenderThread.h"
+#include "Sampler.h"
+#include "SceneArena.h"
 #include "SceneObject.h"
+#include "ShadowCache.h"
+#include "SharedFramebuffer.h"
 #include "Sphere.h"
 #include "Tetrahedron.h"
 #include "TextureBMP.h"
+#include "Tile.h"
+#include "TilePool.h"
+#include "Timeline.h"
+#include "Views.h"
+#include "VisibilityBuffer.h"
 #include <GL/glut.h>
+#include <chrono>
 #include <cmath>
 #include <glm/glm.hpp>
 #include <iostream>
+#include <string.h>
+#include <unistd.h>
 #include <vector>
 using namespace std;
 
@@ -26,9 +56,41 @@ const float EDIST = 40.0;
 // the number of cells along x and y directions
 const int NUMDIV = 500;
 
-// the number of levels of recursion
+// the number of samples per pixel when anti-aliasing
+const int NUMSAMPLES = 4;
+
+// the lowest number of cells along x and y while the camera is moving
+const int MIN_NUMDIV = 50;
+
+// the frame time to aim for while the camera is moving, in milliseconds
+const float TARGET_FRAME_MS = 1000.0 / 15.0;
+
+// how long the camera must be still before full quality is restored
+const int SETTLE_MS = 250;
+
+// how often the window checks for a newly traced frame, in milliseconds
+const int FRAME_POLL_MS = 5;
+
+// distance moved per key press, in world units
+const float MOVE_STEP = 2.0;
+
+// rotation per arrow key press, in radians
+const float ROTATE_STEP = 0.05;
+
+// rotation per pixel of mouse drag, in radians
+const float MOUSE_SENSITIVITY = 0.005;
+
+// the default number of levels of recursion
 const int MAX_STEPS = 5;
 
+// the sampler dimensions used at each level of recursion: one per light for
+// soft shadows, one for glossy reflection, and one each for the Russian
+// roulette of reflected and transmitted rays
+const int GLOSS_DECISION = NUM_LIGHTS;
+const int REFLECTION_ROULETTE = NUM_LIGHTS + 1;
+const int TRANSMISSION_ROULETTE = NUM_LIGHTS + 2;
+const int DIMENSIONS_PER_STEP = NUM_LIGHTS + 3;
+
 // boundary values of the image plane
 const float XMIN = -WIDTH * 0.5;
 const float XMAX = WIDTH * 0.5;
@@ -40,130 +102,564 @@ const glm::vec3 floorB = glm::vec3(20.0, -20, -40);
 const glm::vec3 floorC = glm::vec3(20.0, -20, -200);
 const glm::vec3 floorD = glm::vec3(-20.0, -20, -200);
 
-const float pixel = (XMAX - XMIN) / 500;
-const float pixelQuarter = pixel / 4;
-
 const float TRANSPARENCY = 0.6;
 const float ETA = 1.0 / 1.5;
 
+// how far around a point caustic photons are gathered, in world units
+const float CAUSTIC_RADIUS = 0.3;
+
+// the time between frames of a headless animation, in seconds
+const float FRAME_SECONDS = 1.0 / 30;
+
+// the number of timeline zones each thread keeps before dropping the oldest
+const size_t TIMELINE_EVENTS = 1 << 16;
+
+// the width and height, in cells, of the blocks probed by one ray when an image
+// is traced within a time budget
+const int PROBE_STRIDE = 4;
+
+// the fraction of a time budget kept back for writing the image
+const float WRITE_RESERVE = 0.1;
+
 const glm::vec3 earthCenter = glm::vec3(5.0, 5.0, -30.0);
 
+// the primary and secondary lights
+const glm::vec3 lights[NUM_LIGHTS] = {glm::vec3(-10, 40, -3),
+                                      glm::vec3(40, 40, -100)};
+
+/**
+ * @brief Whether shading uses exact or approximate maths.
+ *
+ */
+MathMode mathMode = MATH_EXACT;
+
+/**
+ * @brief The instruction set of the kernels in use.
+ *
+ */
+IsaLevel kernelIsa = ISA_GENERIC;
+
 /**
  * @brief BMP texture for the floor plane.
  *
  */
 TextureBMP earthTexture;
 
+// Whether `earthTexture` has been read, which is only done once per process
+bool earthTextureLoaded = false;
+
 // A global list containing pointers to objects in the scene
 vector<SceneObject *> sceneObjects;
 
+// Whether objects in the scene cast shadows, which `--no-shadows` turns off
+bool sceneShadows = true;
+
 /**
- * @brief Computes the color value obtained by tracing a ray and finding its
- * closest point of intersection with objects in the scene. If `xindex` is `-1`,
- * then the background color is returned. Otherwise, it returns the object's
- * color.
+ * @brief Owns the objects in `sceneObjects`, which are stored contiguously in
+ * the same order.
  *
- * @param ray
- * @param step
- * @return glm::vec3
  */
-glm::vec3 trace(Ray ray, int step) {
-  glm::vec3 backgroundCol(0);
-  glm::vec3 primaryLight(-10, 40, -3);
-  glm::vec3 secondaryLight(40, 40, -100);
+SceneArena sceneArena;
 
-  // Ambient color of light
-  glm::vec3 ambientCol(0.2);
+/**
+ * @brief The acceleration structure over `sceneObjects`, rebuilt whenever a
+ * scene is loaded. Instances hold their own trees over their prototype's
+ * parts, making a two level hierarchy.
+ *
+ */
+BVH sceneBVH;
 
-  // Compute the closest point of intersection of objects with the ray
-  ray.closestPt(sceneObjects);
+/**
+ * @brief Where frames are published for other processes, if `--shared` was
+ * given.
+ *
+ */
+SharedFramebuffer sharedFrame;
 
-  // If there is no intersection return background colour
-  if (ray.xindex == -1) {
-    return backgroundCol;
-  }
+/**
+ * @brief The scene built by `initializeScene()`: "default", "crates" or
+ * "mirrors".
+ *
+ */
+string sceneName = "default";
 
-  // else return object's colour
-  glm::vec3 materialCol = sceneObjects[ray.xindex]->getColor();
+/**
+ * @brief Whether primary rays only test the objects listed for their cell by
+ * `primaryVisibility`, rather than searching the whole scene.
+ *
+ */
+bool rasterPrimary = false;
+
+/**
+ * @brief The objects which could be hit by the primary rays of each cell,
+ * rebuilt whenever the camera, resolution or scene changes.
+ *
+ */
+VisibilityBuffer primaryVisibility;
+
+/**
+ * @brief Counts the scenes loaded so far, so that per-thread caches can tell
+ * when their contents are out of date.
+ *
+ */
+unsigned sceneGeneration = 0;
+
+/**
+ * @brief An object which moves in the animation, and where it rests.
+ *
+ */
+struct AnimatedObject {
+  Instance *instance;
+  int index; // Its index in `sceneObjects`
+  glm::vec3 rest;
+};
+
+/**
+ * @brief Whether the earth and the cylinder are built as instances, which can
+ * be moved between frames.
+ *
+ */
+bool animateScene = false;
+
+/**
+ * @brief The objects which move in the animation.
+ *
+ */
+vector<AnimatedObject> animatedObjects;
 
-  // normal vector on the sphere at the point of intersection
-  glm::vec3 normalVector = sceneObjects[ray.xindex]->normal(ray.xpt);
+/**
+ * @brief Whether the animation is playing in the window.
+ *
+ */
+bool animationPlaying = true;
 
-  // vector from the point of intersection towards the light source
-  glm::vec3 primaryLightVector = primaryLight - ray.xpt;
-  primaryLightVector = glm::normalize(primaryLightVector);
-  float primaryLDotN = glm::dot(primaryLightVector, normalVector);
+/**
+ * @brief How far the animation in the window has played, in seconds, and when
+ * it was last moved on.
+ *
+ */
+float animationSeconds = 0;
+chrono::steady_clock::time_point animationTick;
 
-  glm::vec3 secondaryLightVector = secondaryLight - ray.xpt;
-  secondaryLightVector = glm::normalize(secondaryLightVector);
-  float secondaryLDotN = glm::dot(secondaryLightVector, normalVector);
+/**
+ * @brief The animation time the scene's objects are at. While the render
+ * thread is running, only it moves the scene.
+ *
+ */
+float sceneSeconds = 0;
 
-  // Specular reflections
+/**
+ * @brief The last occluder of each light, kept separately by every thread.
+ *
+ */
+thread_local ShadowCache shadowCache;
 
-  glm::vec3 viewVector = -ray.dir;
+/**
+ * @brief The radius in world units over which cached lighting is reused, or 0
+ * to trace every shadow ray.
+ *
+ */
+float lightCacheSpacing = 0;
 
-  // first param: incident light's direction (unit vector from light source to
-  // the point of intersection)
-  glm::vec3 primaryReflVector = glm::reflect(-primaryLightVector, normalVector);
-  glm::vec3 secondaryReflVector =
-      glm::reflect(-secondaryLightVector, normalVector);
+/**
+ * @brief The blockers of each light at points traced so far, kept separately
+ * by every thread.
+ *
+ */
+thread_local LightingCache lightingCache;
 
-  float primaryRDotV = glm::dot(primaryReflVector, normalVector);
-  float primarySpecularTerm =
-      primaryRDotV < 0.0 ? 0.0 : pow(primaryRDotV, 20.0);
+/**
+ * @brief The number of photons aimed from each light at each refractive or
+ * transparent object, or 0 to approximate their shadows instead.
+ *
+ */
+int photonCount = 0;
 
-  float secondaryRDotV = glm::dot(secondaryReflVector, normalVector);
-  float secondarySpecularTerm =
-      secondaryRDotV < 0.0 ? 0.0 : pow(secondaryRDotV, 20.0);
+/**
+ * @brief The caustics of the current scene, rebuilt whenever a scene is
+ * loaded.
+ *
+ */
+PhotonMap causticMap;
 
-  // Shadows
-  Ray primaryShadow(ray.xpt, primaryLightVector);
-  primaryShadow.closestPt(sceneObjects);
-  float primaryLightDist = glm::length(secondaryLight);
+/**
+ * @brief Places the samples of each cell, and draws the random decisions made
+ * while tracing them.
+ *
+ */
+Sampler sampler;
 
-  Ray secondaryShadow(ray.xpt, secondaryLightVector);
-  secondaryShadow.closestPt(sceneObjects);
-  float secondaryLightDist = glm::length(secondaryLight);
+/**
+ * @brief The sample being traced by this thread, which the decisions made
+ * while shading are drawn from.
+ *
+ */
+thread_local PixelSample currentSample = {0, 0, 1};
 
-  glm::vec3 colorSum(0);
+/**
+ * @brief The radius of the spherical lights, or 0 for point lights with hard
+ * shadows.
+ *
+ */
+float lightRadius = 0;
+
+/**
+ * @brief How far reflected rays are spread around the mirror direction, as the
+ * radius of a disk one unit along it, or 0 for mirror reflections.
+ *
+ */
+float glossiness = 0;
+
+/**
+ * @brief The most levels of recursion, however much a ray still contributes.
+ * It is checked at run time rather than compiled into the trace kernels, since
+ * `--max-depth` sets it and `--budget` changes it from tile to tile.
+ *
+ */
+int maxDepth = MAX_STEPS;
+
+/**
+ * @brief The fraction of a sample's color below which a secondary ray is not
+ * traced, or 0 to trace every secondary ray up to `maxDepth`.
+ *
+ */
+float minContribution = 0;
+
+/**
+ * @brief Whether secondary rays below `minContribution` are kept at random,
+ * with a weight that keeps the image unbiased, rather than always cut off.
+ *
+ */
+bool russianRoulette = false;
+
+/**
+ * @brief What happened to the secondary rays traced by this thread.
+ *
+ */
+thread_local PathStats pathStats;
+
+/**
+ * @brief The camera which primary rays are generated from.
+ *
+ */
+Camera camera(glm::vec3(0), WIDTH, HEIGHT, EDIST);
 
-  // Earth sphere texture
-  if (ray.xindex == 16) {
-    glm::vec3 d = glm::normalize(ray.xpt - earthCenter);
-    // differs from wikipedia formula, so that the northern hemisphere is on the
-    // top
-    float u = 0.5 - atan2(d.z, d.x) / (2 * M_PI);
-    float v = 0.5 + asinf(d.y) / M_PI;
-    materialCol = earthTexture.getColorAt(u, v);
+/**
+ * @brief Picks the traced resolution and samples per pixel for each frame.
+ *
+ */
+DynamicResolution resolution(NUMDIV, NUMSAMPLES, MIN_NUMDIV, TARGET_FRAME_MS);
+
+/**
+ * @brief Traces frames for the window in the background. Only created when
+ * running with a window.
+ *
+ */
+RenderThread *renderThread = NULL;
+
+/**
+ * @brief The file the timeline is written to at exit, if it is recorded.
+ *
+ */
+const char *timelineFile = NULL;
+
+/**
+ * @brief The time at which the camera last moved.
+ *
+ */
+chrono::steady_clock::time_point lastMoveTime;
+
+// The last position of the mouse while dragging with the left button
+int dragX, dragY;
+bool dragging = false;
+
+/**
+ * @brief The features of a scene that `traceScene` can be specialized on. A
+ * kernel compiled without a feature skips that feature's checks entirely.
+ *
+ */
+enum TraceFeature {
+  FEATURE_REFLECTION = 1 << 0,
+  FEATURE_REFRACTION = 1 << 1,
+  FEATURE_TRANSPARENCY = 1 << 2,
+  FEATURE_SHADOWS = 1 << 3,
+  FEATURE_TEXTURES = 1 << 4,
+  ALL_FEATURES = (1 << 5) - 1
+};
+
+template <unsigned Features>
+glm::vec3 traceScene(const Ray &ray, int step, float throughput);
+
+/**
+ * @brief Finds the closest intersection of a ray with the objects in the
+ * scene.
+ *
+ * @param ray
+ * @return Hit
+ */
+Hit intersectScene(const Ray &ray) {
+  return sceneBVH.closestHit(ray, sceneObjects);
+}
+
+/**
+ * @brief Finds what blocks a shadow ray, testing the light's last occluder
+ * before searching the whole scene.
+ *
+ * Shading only needs to know whether the ray is blocked before `lightDist`,
+ * and, when the scene has transparent objects, whether the closest blocker is
+ * transparent. So when the last occluder blocks the ray, a kernel without
+ * transparency returns it as it is, and otherwise the search is limited to
+ * objects no further away than it.
+ *
+ * @tparam Features The `TraceFeature`s used by the scene.
+ * @param ray The shadow ray.
+ * @param light The index of the light the ray points at.
+ * @param lightDist How far away an object must be to not cast a shadow.
+ * @return Hit
+ */
+template <unsigned Features>
+Hit findOccluder(Ray ray, int light, float lightDist) {
+  const bool transparency = Features & FEATURE_TRANSPARENCY;
+
+  int cached = shadowCache.occluder(light);
+  if (cached != -1) {
+    int part;
+    float t = sceneObjects[cached]->intersectPart(ray.pt, ray.dir, &part);
+    if (t > ray.tmin && t < lightDist) {
+      shadowCache.hit(light);
+      if (!transparency) {
+        Hit hit;
+        hit.t = t;
+        hit.index = cached;
+        hit.part = part;
+        return hit;
+      }
+      ray.tmax = nextafterf(t, INFINITY);
+      return intersectScene(ray);
+    }
   }
 
-  // Floor texture
-  if (ray.xindex == 3) {
-    int floorX = (int)((ray.xpt.x + 20) / 5) % 2;
-    int floorZ = (int)(ray.xpt.z / 5) % 2;
+  Hit hit = intersectScene(ray);
+  shadowCache.miss(light, hit.t < lightDist ? hit.index : -1);
+  return hit;
+}
 
-    if ((floorX + floorZ) % 2 == 0) {
-      materialCol = glm::vec3(0.050, 0.184, 0.611);
-    } else {
-      materialCol = glm::vec3(0.827, 0.011, 0.011);
+/**
+ * @brief Gets the sampler dimension used for a decision at a level of
+ * recursion.
+ *
+ * @param step The level of recursion, from 1 for primary rays.
+ * @param decision A light's index for its shadow ray, or `GLOSS_DECISION`.
+ * @return int
+ */
+int sampleDimension(int step, int decision) {
+  return 1 + (step - 1) * DIMENSIONS_PER_STEP + decision;
+}
+
+/**
+ * @brief Offsets a point on the disk of the given radius around a unit axis,
+ * at the point of the disk which `u` maps to.
+ *
+ * @param axis
+ * @param radius
+ * @param u A point in the unit square, from the sampler.
+ * @return glm::vec3 The offset, which is perpendicular to `axis`.
+ */
+glm::vec3 diskOffset(glm::vec3 axis, float radius, glm::vec2 u) {
+  glm::vec3 helper =
+      fabsf(axis.x) > 0.9f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+  glm::vec3 tangent = glm::normalize(glm::cross(helper, axis));
+  glm::vec3 bitangent = glm::cross(axis, tangent);
+  glm::vec2 d = Sampler::squareToDisk(u) * radius;
+  return tangent * d.x + bitangent * d.y;
+}
+
+/**
+ * @brief Chooses the direction of a shadow ray towards a spherical light,
+ * aimed at a point on the light's disk as seen from `point`.
+ *
+ * @param point The point being shaded.
+ * @param light The light's index.
+ * @param step The level of recursion.
+ * @return glm::vec3 A unit vector.
+ */
+glm::vec3 sampleLightDirection(glm::vec3 point, int light, int step) {
+  glm::vec3 toLight = lights[light] - point;
+  glm::vec2 u = sampler.get2D(currentSample, sampleDimension(step, light));
+  glm::vec3 offset = diskOffset(glm::normalize(toLight), lightRadius, u);
+  return glm::normalize(toLight + offset);
+}
+
+/**
+ * @brief Decides whether to trace a secondary ray, from how much it can still
+ * add to its sample. Rays contributing at least `minContribution` are traced,
+ * and weaker rays are cut off, or with `russianRoulette` kept with probability
+ * proportional to their contribution and weighted up to make up for the rays
+ * that were cut off.
+ *
+ * @param throughput The fraction of its sample's color the ray would carry.
+ * @param step The level of recursion of the ray's origin.
+ * @param decision The sampler dimension used for Russian roulette.
+ * @param lostRoulette If not NULL, set to whether the ray was not traced
+ * because it lost Russian roulette, rather than being cut off for good.
+ * @return float The weight of the ray's color, or 0 if it is not traced.
+ */
+float continuePath(float throughput, int step, int decision,
+                   bool *lostRoulette = NULL) {
+  if (step >= maxDepth) {
+    pathStats.capDepth();
+    return 0;
+  }
+  if (throughput >= minContribution) {
+    pathStats.trace();
+    return 1;
+  }
+  if (russianRoulette) {
+    float survival = throughput / minContribution;
+    float u = sampler.get2D(currentSample, sampleDimension(step, decision)).x;
+    if (u < survival) {
+      pathStats.survive();
+      return 1 / survival;
+    }
+    if (lostRoulette != NULL) {
+      *lostRoulette = true;
     }
   }
+  pathStats.cutOff();
+  return 0;
+}
+
+/**
+ * @brief Computes the color of a point where a ray hit an object, from its
+ * direct lighting terms.
+ *
+ * The kernel is compiled once for every combination of `TraceFeature`s, and
+ * features which are not in `Features` are compiled out. Secondary rays are
+ * only traced if `continuePath` accepts them.
+ *
+ * @tparam Features The `TraceFeature`s used by the scene.
+ * @param ray The ray which hit the object.
+ * @param hit The closest intersection along the ray.
+ * @param hitPt The point of intersection.
+ * @param normalVector The object's unit normal at `hitPt`.
+ * @param lighting The direct lighting terms at `hitPt`.
+ * @param step
+ * @param throughput The fraction of its sample's color the ray carries.
+ * @return glm::vec3
+ */
+template <unsigned Features>
+glm::vec3 shadeHit(const Ray &ray, const Hit &hit, glm::vec3 hitPt,
+                   glm::vec3 normalVector, const LocalLighting &lighting,
+                   int step, float throughput) {
+  const bool reflection = Features & FEATURE_REFLECTION;
+  const bool refraction = Features & FEATURE_REFRACTION;
+  const bool transparency = Features & FEATURE_TRANSPARENCY;
+  const bool shadows = Features & FEATURE_SHADOWS;
+  const bool textures = Features & FEATURE_TEXTURES;
 
-  if (ray.xindex == 17) {
-    int value = (int)(ray.xpt.x + ray.xpt.z) % 2;
-    if (value == 0) {
-      materialCol = glm::vec3(0.901, 0.941, 0.156);
+  glm::vec3 backgroundCol(0);
+
+  // Ambient color of light
+  glm::vec3 ambientCol(0.2);
+
+  SceneObject *object = sceneObjects[hit.index];
+
+  // else return object's colour
+  glm::vec3 materialCol = object->getColor();
+
+  glm::vec3 primaryLightVector = lighting.lightVector[0];
+  float primaryLDotN = lighting.lDotN[0];
+  float primarySpecularTerm = lighting.specular[0];
+
+  glm::vec3 secondaryLightVector = lighting.lightVector[1];
+  float secondaryLDotN = lighting.lDotN[1];
+  float secondarySpecularTerm = lighting.specular[1];
+
+  // Shadows
+  Hit primaryShadow;
+  Hit secondaryShadow;
+  float primaryLightDist = glm::length(lights[1]);
+  float secondaryLightDist = glm::length(lights[1]);
+  if (shadows) {
+    Hit blockers[NUM_LIGHTS];
+    if (lightingCache.isEnabled() &&
+        lightingCache.lookup(hit.index, hitPt, normalVector, blockers)) {
+      primaryShadow = blockers[0];
+      secondaryShadow = blockers[1];
     } else {
-      materialCol = glm::vec3(0.156, 0.941, 0.403);
+      glm::vec3 primaryShadowDir = primaryLightVector;
+      glm::vec3 secondaryShadowDir = secondaryLightVector;
+      if (lightRadius > 0) {
+        primaryShadowDir = sampleLightDirection(hitPt, 0, step);
+        secondaryShadowDir = sampleLightDirection(hitPt, 1, step);
+      }
+      primaryShadow = findOccluder<Features>(Ray(hitPt, primaryShadowDir), 0,
+                                             primaryLightDist);
+      secondaryShadow = findOccluder<Features>(Ray(hitPt, secondaryShadowDir),
+                                               1, secondaryLightDist);
+      if (lightingCache.isEnabled()) {
+        blockers[0] = primaryShadow;
+        blockers[1] = secondaryShadow;
+        lightingCache.insert(hit.index, hitPt, normalVector, blockers);
+      }
+    }
+  }
+
+  glm::vec3 colorSum(0);
+
+  // Without a photon map, shadows of transparent objects are lightened
+  // instead
+  bool approximateCaustics = causticMap.isEmpty();
+
+  if (textures) {
+    switch (object->getPattern()) {
+      case PATTERN_TEXTURE: {
+        // The sphere's normal is the unit vector from its center to the point.
+        // This differs from the wikipedia formula, so that the northern
+        // hemisphere is on the top
+        float u, v;
+        if (mathMode == MATH_FAST) {
+          u = 0.5f - fastAtan2(normalVector.z, normalVector.x) / (2 * M_PI);
+          v = 0.5f + fastAsin(normalVector.y) / M_PI;
+        } else {
+          u = 0.5 - atan2(normalVector.z, normalVector.x) / (2 * M_PI);
+          v = 0.5 + asinf(normalVector.y) / M_PI;
+        }
+        materialCol = object->getTexture()->getColorAt(u, v);
+        break;
+      }
+      case PATTERN_CHECKERS: {
+        int floorX = (int)((hitPt.x + 20) / 5) % 2;
+        int floorZ = (int)(hitPt.z / 5) % 2;
+
+        if ((floorX + floorZ) % 2 == 0) {
+          materialCol = glm::vec3(0.050, 0.184, 0.611);
+        } else {
+          materialCol = glm::vec3(0.827, 0.011, 0.011);
+        }
+        break;
+      }
+      case PATTERN_STRIPES: {
+        int value = (int)(hitPt.x + hitPt.z) % 2;
+        if (value == 0) {
+          materialCol = glm::vec3(0.901, 0.941, 0.156);
+        } else {
+          materialCol = glm::vec3(0.156, 0.941, 0.403);
+        }
+        break;
+      }
+      case PATTERN_NONE:
+        break;
     }
   }
 
   if (primaryLDotN <= 0 ||
-      (primaryShadow.xindex > -1 && primaryShadow.xdist < primaryLightDist)) {
+      (primaryShadow.index > -1 && primaryShadow.t < primaryLightDist)) {
     colorSum += ambientCol * materialCol;
 
     // make the shadow of the transparent object lighter
-    if (primaryShadow.xindex == 5) {
+    if (transparency && approximateCaustics && primaryShadow.index > -1 &&
+        sceneObjects[primaryShadow.index]->isTransparent()) {
       colorSum +=
           (primaryLDotN * materialCol + primarySpecularTerm) * glm::vec3(0.5) +
           sceneObjects[2]->getColor() * glm::vec3(0.025);
@@ -173,11 +669,12 @@ glm::vec3 trace(Ray ray, int step) {
                 primarySpecularTerm;
   }
 
-  if (secondaryLDotN <= 0 || (secondaryShadow.xindex > -1 &&
-                              secondaryShadow.xdist < secondaryLightDist)) {
+  if (secondaryLDotN <= 0 || (secondaryShadow.index > -1 &&
+                              secondaryShadow.t < secondaryLightDist)) {
     colorSum += ambientCol * materialCol;
     // make the shadow of the transparent object lighter
-    if (secondaryShadow.xindex == 5) {
+    if (transparency && approximateCaustics && secondaryShadow.index > -1 &&
+        sceneObjects[secondaryShadow.index]->isTransparent()) {
       colorSum += (secondaryLDotN * materialCol + secondarySpecularTerm) *
                       glm::vec3(0.5) +
                   sceneObjects[2]->getColor() * glm::vec3(0.025);
@@ -187,49 +684,107 @@ glm::vec3 trace(Ray ray, int step) {
                 secondarySpecularTerm;
   }
 
+  // Light focused or filtered by refractive and transparent objects
+  if (!approximateCaustics) {
+    colorSum += causticMap.irradiance(hit.index, hitPt) * materialCol;
+  }
+
   // Reflection
-  if (ray.xindex == 0 && step < MAX_STEPS) {
+  float reflectedThroughput = 0;
+  float reflectedWeight = 0;
+  if (reflection && object->getReflectivity() > 0) {
+    reflectedThroughput = throughput * object->getReflectivity();
+    reflectedWeight =
+        continuePath(reflectedThroughput, step, REFLECTION_ROULETTE);
+  }
+  if (reflectedWeight > 0) {
     // the following does not need to be normalized as it will have a unit
     // length, since both the incident rays direction and the normal vector
     // are unit vectors
     glm::vec3 reflectedDir = glm::reflect(ray.dir, normalVector);
 
+    // Glossy reflections spread around the mirror direction, but stay above
+    // the surface
+    if (glossiness > 0) {
+      glm::vec2 u =
+          sampler.get2D(currentSample, sampleDimension(step, GLOSS_DECISION));
+      glm::vec3 glossyDir = glm::normalize(
+          reflectedDir + diskOffset(reflectedDir, glossiness, u));
+      if (glm::dot(glossyDir, normalVector) > 0) {
+        reflectedDir = glossyDir;
+      }
+    }
+
     // Defines the reflected ray using its source (the point of
     // intersection  on the object), and the direction
-    Ray reflectedRay(ray.xpt, reflectedDir);
+    Ray reflectedRay(hitPt, reflectedDir);
 
     // Recursive
-    glm::vec3 reflectedCol = trace(reflectedRay, step + 1);
+    glm::vec3 reflectedCol = traceScene<Features>(
+        reflectedRay, step + 1, reflectedThroughput * reflectedWeight);
+    if (reflectedWeight != 1) {
+      reflectedCol *= reflectedWeight;
+    }
+
+    colorSum = colorSum + (object->getReflectivity() * reflectedCol);
+  }
 
-    // Coefficient of reflection is specified as 0.8
-    colorSum = colorSum + (0.8f * reflectedCol);
+  // Refraction and transparency both pass on part of the ray. A ray cut off
+  // by the depth or contribution limit leaves the object's own color, but one
+  // which lost Russian roulette counts as transmitting black, so that the
+  // rays which survive, weighted up, keep the average unbiased
+  float transmittedThroughput = throughput * (1 - TRANSPARENCY);
+  float transmittedWeight = 0;
+  bool lostRoulette = false;
+  if ((refraction && object->isRefractive()) ||
+      (transparency && object->isTransparent())) {
+    transmittedWeight = continuePath(transmittedThroughput, step,
+                                     TRANSMISSION_ROULETTE, &lostRoulette);
   }
 
-  // Refraction
-  if (ray.xindex == 2 && step < MAX_STEPS) {
+  // Refraction. Whether the refracted ray escapes the scene is found before
+  // the roulette result is used, as an escaping ray gives the background
+  // whether it is traced or not
+  if (refraction && object->isRefractive() &&
+      (transmittedWeight > 0 || lostRoulette)) {
     glm::vec3 g = glm::refract(ray.dir, normalVector, ETA);
-    Ray refractRay(ray.xpt, g);
-    refractRay.closestPt(sceneObjects);
-    if (refractRay.xindex == -1) {
+    Ray refractRay(hitPt, g);
+    Hit refractHit = intersectScene(refractRay);
+    if (refractHit.index == -1) {
       return backgroundCol;
     }
-    glm::vec3 m = sceneObjects[refractRay.xindex]->normal(refractRay.xpt);
+    glm::vec3 refractPt = refractRay.at(refractHit.t);
+    SceneObject *exitObject = sceneObjects[refractHit.index];
+    glm::vec3 m = exitObject->normalOfPart(refractPt, refractHit.part);
     glm::vec3 h = glm::refract(g, -m, 1.0f / ETA);
 
-    Ray refractOutRay(refractRay.xpt, h);
-    refractOutRay.closestPt(sceneObjects);
-    if (refractOutRay.xindex == -1) {
+    Ray refractOutRay(refractPt, h);
+    if (intersectScene(refractOutRay).index == -1) {
       return backgroundCol;
     }
-    glm::vec3 refractColor = trace(refractOutRay, step + 1);
+    if (lostRoulette) {
+      return colorSum * TRANSPARENCY;
+    }
+    glm::vec3 refractColor = traceScene<Features>(
+        refractOutRay, step + 1, transmittedThroughput * transmittedWeight);
+    if (transmittedWeight != 1) {
+      refractColor *= transmittedWeight;
+    }
     colorSum = colorSum * TRANSPARENCY + refractColor * (1 - TRANSPARENCY);
     return colorSum;
   }
 
   // Transparency
-  if (ray.xindex == 5 && step < MAX_STEPS) {
-    Ray transparentRay(ray.xpt, ray.dir);
-    glm::vec3 transparentColor = trace(transparentRay, step + 1);
+  if (transparency && object->isTransparent() && lostRoulette) {
+    return colorSum * TRANSPARENCY;
+  }
+  if (transparency && object->isTransparent() && transmittedWeight > 0) {
+    Ray transparentRay(hitPt, ray.dir);
+    glm::vec3 transparentColor = traceScene<Features>(
+        transparentRay, step + 1, transmittedThroughput * transmittedWeight);
+    if (transmittedWeight != 1) {
+      transparentColor *= transmittedWeight;
+    }
     colorSum = colorSum * TRANSPARENCY + transparentColor * (1 - TRANSPARENCY);
   }
 
@@ -237,154 +792,1293 @@ glm::vec3 trace(Ray ray, int step) {
 }
 
 /**
- * @brief Adds anti-aliasing functionality to the ray tracer.
+ * @brief Computes the color value obtained by tracing a ray and finding its
+ * closest point of intersection with objects in the scene. If the ray does not
+ * hit anything, then the background color is returned. Otherwise, it returns
+ * the object's color.
  *
- * @param eye
- * @param x
- * @param y
+ * @tparam Features The `TraceFeature`s used by the scene.
+ * @param ray
+ * @param step
+ * @param throughput The fraction of its sample's color the ray carries.
  * @return glm::vec3
  */
-glm::vec3 antiAliase(glm::vec3 eye, float x, float y) {
-  glm::vec3 color = glm::vec3(0);
-
-  Ray bottomLeft =
-      Ray(eye, glm::vec3(x - pixelQuarter, y - pixelQuarter, -EDIST));
-  bottomLeft.normalize();
-  color += trace(bottomLeft, 1);
+template <unsigned Features>
+glm::vec3 traceScene(const Ray &ray, int step, float throughput) {
+  // Compute the closest point of intersection of objects with the ray
+  Hit hit = intersectScene(ray);
 
-  Ray bottomRight =
-      Ray(eye, glm::vec3(x + pixelQuarter, y - pixelQuarter, -EDIST));
-  bottomRight.normalize();
-  color += trace(bottomRight, 1);
+  // If there is no intersection return background colour
+  if (hit.index == -1) {
+    return glm::vec3(0);
+  }
 
-  Ray topLeft = Ray(eye, glm::vec3(x - pixelQuarter, y + pixelQuarter, -EDIST));
-  topLeft.normalize();
-  color += trace(topLeft, 1);
+  // The point of intersection is only computed once the closest object is
+  // known
+  glm::vec3 hitPt = ray.at(hit.t);
 
-  Ray topRight =
-      Ray(eye, glm::vec3(x + pixelQuarter, y + pixelQuarter, -EDIST));
-  topRight.normalize();
-  color += trace(topRight, 1);
+  // normal vector on the object at the point of intersection
+  glm::vec3 normalVector =
+      sceneObjects[hit.index]->normalOfPart(hitPt, hit.part);
 
-  return color * glm::vec3(0.25);
+  LocalLighting lighting;
+  computeLighting(mathMode, lights, &hitPt, &normalVector, 1, &lighting);
+  return shadeHit<Features>(ray, hit, hitPt, normalVector, lighting, step,
+                            throughput);
 }
 
 /**
- * @brief The main display module. In a ray tracing application, it just
- * displays the ray traced image by drawing each cell as a quad.
+ * @brief Shades a batch of primary rays, whose closest hits have already been
+ * found. The direct lighting of every hit is computed together by
+ * `computeLighting`, and then each hit is shaded.
  *
+ * @tparam Features The `TraceFeature`s used by the scene.
+ * @param rays
+ * @param rayHits The closest hit of each ray.
+ * @param raySamples The sample each ray belongs to.
+ * @param count The number of rays, at most `SHADING_BATCH`.
+ * @param colors Receives the color of each ray.
  */
-void display() {
-  float xp, yp;                         // grid point
-  float cellX = (XMAX - XMIN) / NUMDIV; // cell width
-  float cellY = (YMAX - YMIN) / NUMDIV; // cell height
-
-  // A ray is generated from the origin through the center of each cell
-  // The eye position (source of primary rays) is the origin
-  glm::vec3 eye(0.0, 0.0, 0.0);
-
-  glClear(GL_COLOR_BUFFER_BIT);
-  glMatrixMode(GL_MODELVIEW);
-  glLoadIdentity();
+template <unsigned Features>
+void traceBatch(const Ray *rays, const Hit *rayHits,
+                const PixelSample *raySamples, int count, glm::vec3 *colors) {
+  Hit hits[SHADING_BATCH];
+  int rayIndex[SHADING_BATCH];
+  glm::vec3 points[SHADING_BATCH];
+  glm::vec3 normals[SHADING_BATCH];
+  LocalLighting lighting[SHADING_BATCH];
+
+  int hitCount = 0;
+  for (int i = 0; i < count; i++) {
+    const Hit &hit = rayHits[i];
+    if (hit.index == -1) {
+      colors[i] = glm::vec3(0);
+      continue;
+    }
+    hits[hitCount] = hit;
+    rayIndex[hitCount] = i;
+    points[hitCount] = rays[i].at(hit.t);
+    normals[hitCount] =
+        sceneObjects[hit.index]->normalOfPart(points[hitCount], hit.part);
+    hitCount++;
+  }
 
-  // draws each cell as a quad
-  // Each cell is a quad.
-  glBegin(GL_QUADS);
+  computeLighting(mathMode, lights, points, normals, hitCount, lighting);
 
-  // For each grid point xp, yp
-  for (int i = 0; i < NUMDIV; i++) {
-    xp = XMIN + i * cellX;
-    for (int j = 0; j < NUMDIV; j++) {
-      yp = YMIN + j * cellY;
+  for (int k = 0; k < hitCount; k++) {
+    int i = rayIndex[k];
+    currentSample = raySamples[i];
+    colors[i] = shadeHit<Features>(rays[i], hits[k], points[k], normals[k],
+                                   lighting[k], 1, 1);
+  }
+}
 
-      // direction of the primary ray
-      glm::vec3 dir(xp + 0.5 * cellX, yp + 0.5 * cellY, -EDIST);
+typedef glm::vec3 (*TraceKernel)(const Ray &ray, int step, float throughput);
+typedef void (*BatchKernel)(const Ray *rays, const Hit *rayHits,
+                            const PixelSample *raySamples, int count,
+                            glm::vec3 *colors);
 
-      // Create a ray originating from the camera in the direction 'dir'
-      Ray ray = Ray(eye, dir);
+/**
+ * @brief Fills `table[f]` with `traceScene<f>` and `batches[f]` with
+ * `traceBatch<f>`, for every `f <= Features`.
+ *
+ */
+template <unsigned Features> struct TraceKernelTable {
+  static void fill(TraceKernel *table, BatchKernel *batches) {
+    table[Features] = &traceScene<Features>;
+    batches[Features] = &traceBatch<Features>;
+    TraceKernelTable<Features - 1>::fill(table, batches);
+  }
+};
 
-      // Normalize the direction of the ray to a unit vector
-      ray.normalize();
+template <> struct TraceKernelTable<0> {
+  static void fill(TraceKernel *table, BatchKernel *batches) {
+    table[0] = &traceScene<0>;
+    batches[0] = &traceBatch<0>;
+  }
+};
 
-      // Trace the primary ray and get the colour value
-      glm::vec3 col = antiAliase(eye, xp, yp);
-      // glm::vec3 col = trace(ray, 1);
+/**
+ * @brief The kernels specialized for the current scene, chosen by
+ * `selectTraceKernel()` whenever a scene is loaded.
+ *
+ */
+TraceKernel traceKernel = &traceScene<ALL_FEATURES>;
+BatchKernel batchKernel = &traceBatch<ALL_FEATURES>;
 
-      glColor3f(col.r, col.g, col.b);
-      // Draw each cell with its color value
-      glVertex2f(xp, yp);
-      glVertex2f(xp + cellX, yp);
-      glVertex2f(xp + cellX, yp + cellY);
-      glVertex2f(xp, yp + cellY);
+/**
+ * @brief Finds the features used by the objects in the scene, and selects the
+ * matching specializations of `traceScene` and `traceBatch`.
+ *
+ * @return unsigned The features of the scene.
+ */
+unsigned selectTraceKernel() {
+  unsigned features = sceneShadows ? FEATURE_SHADOWS : 0;
+  for (size_t i = 0; i < sceneObjects.size(); i++) {
+    SceneObject *object = sceneObjects[i];
+    if (object->getReflectivity() > 0) {
+      features |= FEATURE_REFLECTION;
+    }
+    if (object->isRefractive()) {
+      features |= FEATURE_REFRACTION;
+    }
+    if (object->isTransparent()) {
+      features |= FEATURE_TRANSPARENCY;
+    }
+    if (object->getPattern() != PATTERN_NONE) {
+      features |= FEATURE_TEXTURES;
     }
   }
 
-  glEnd();
-  glFlush();
+  static TraceKernel kernels[ALL_FEATURES + 1];
+  static BatchKernel batchKernels[ALL_FEATURES + 1];
+  if (kernels[0] == NULL) {
+    TraceKernelTable<ALL_FEATURES>::fill(kernels, batchKernels);
+  }
+  traceKernel = kernels[features];
+  batchKernel = batchKernels[features];
+  return features;
 }
 
 /**
- * @brief This function initializes the scene.
- * Specifically, it creates scene objects (spheres, planes, cones, cylinders
- * etc.) and adds them to the list of scene objects. It also initializes the
- * OpenGL othographic projection matrix for drawing the ray traced image.
- */
-void initialize() {
-  glMatrixMode(GL_PROJECTION);
-  gluOrtho2D(XMIN, XMAX, YMIN, YMAX);
-  glClearColor(0, 0, 0, 1);
+ * @brief Traces a ray with the kernel selected for the current scene.
+ *
+ * @param ray
+ * @param step
+ * @param throughput The fraction of its sample's color the ray carries.
+ * @return glm::vec3
+ */
+glm::vec3 trace(const Ray &ray, int step, float throughput) {
+  return traceKernel(ray, step, throughput);
+}
+
+/**
+ * @brief Creates a normalized primary ray from a camera through the point
+ * (x, y) on its image plane.
+ *
+ * @param view
+ * @param x
+ * @param y
+ * @return Ray
+ */
+Ray primaryRay(const Camera &view, float x, float y) {
+  Ray ray = Ray(view.eye, view.direction(x, y));
+  ray.normalize();
+  return ray;
+}
+
+/**
+ * @brief Makes sure `primaryVisibility` matches the camera, resolution and
+ * scene, when primary rays are rasterized.
+ *
+ * @param view
+ * @param divisions
+ */
+void preparePrimaryVisibility(const Camera &view, int divisions) {
+  if (rasterPrimary &&
+      !primaryVisibility.isBuiltFor(view, divisions, sceneObjects)) {
+    TimelineZone zone("Build visibility lists");
+    primaryVisibility.build(view, divisions, sceneObjects);
+  }
+}
+
+/**
+ * @brief Makes sure the calling thread's caches belong to the current scene
+ * and settings.
+ *
+ */
+void prepareThreadCaches() {
+  shadowCache.useScene(sceneGeneration);
+  lightingCache.configure(lightCacheSpacing, sceneGeneration);
+}
+
+/**
+ * @brief Traces the cells of a tile of the image. The primary rays of each row
+ * are traced in batches of up to `SHADING_BATCH` rays, so that their hits are
+ * shaded together, and the samples of a cell may be split across batches.
+ * With `rasterPrimary`, primary rays only test the objects listed for their
+ * cell; other rays always search the whole scene.
+ *
+ * With one sample per cell, the ray goes through the middle of the cell.
+ * Otherwise `sampler` places the samples within a cell wide square around the
+ * cell's grid point, and their colors are averaged.
+ *
+ * @param view The camera the image is traced from.
+ * @param tile The cells to trace.
+ * @param divisions The number of cells along x and y in the whole image.
+ * @param samples The number of samples per cell.
+ * @param pixels Receives `tile.width * tile.height` colours, stored row by row
+ * from the bottom row of the tile.
+ */
+void renderTile(const Camera &view, const Tile &tile, int divisions,
+                int samples, glm::vec3 *pixels) {
+  TimelineZone zone("Trace tile");
+  float xp, yp;                          // grid point
+  float cellX = view.width / divisions;  // cell width
+  float cellY = view.height / divisions; // cell height
+
+  Ray rays[SHADING_BATCH];
+  Hit hits[SHADING_BATCH];
+  PixelSample raySamples[SHADING_BATCH];
+  glm::vec3 colors[SHADING_BATCH];
+  int raysPerRow = tile.width * samples;
+  glm::vec3 sampleWeight = glm::vec3(1.0f / samples);
+
+  preparePrimaryVisibility(view, divisions);
+  prepareThreadCaches();
+
+  for (int j = 0; j < tile.height; j++) {
+    int y = tile.y + j;
+    yp = view.ymin() + y * cellY;
+    glm::vec3 *row = &pixels[j * tile.width];
+    for (int first = 0; first < raysPerRow; first += SHADING_BATCH) {
+      int count = min(SHADING_BATCH, raysPerRow - first);
+
+      // Create the primary ray of each sample in the batch
+      for (int r = 0; r < count; r++) {
+        int x = tile.x + (first + r) / samples;
+        xp = view.xmin() + x * cellX;
+        PixelSample &sample = raySamples[r];
+        sample.seed = Sampler::pixelSeed(x, y);
+        sample.index = (first + r) % samples;
+        sample.count = samples;
+        if (samples > 1) {
+          glm::vec2 u = sampler.get2D(sample, 0);
+          rays[r] = primaryRay(view, xp + (u.x - 0.5f) * cellX,
+                               yp + (u.y - 0.5f) * cellY);
+        } else {
+          rays[r] = primaryRay(view, xp + 0.5 * cellX, yp + 0.5 * cellY);
+        }
+
+        if (rasterPrimary) {
+          hits[r] = primaryVisibility.closestHit(rays[r], x, y, sceneObjects);
+        } else {
+          hits[r] = intersectScene(rays[r]);
+        }
+      }
+
+      batchKernel(rays, hits, raySamples, count, colors);
+
+      // Average the samples of each cell
+      for (int r = 0; r < count; r++) {
+        int c = (first + r) / samples;
+        int k = (first + r) % samples;
+        if (k == 0) {
+          row[c] = colors[r];
+        } else {
+          row[c] += colors[r];
+        }
+        if (k == samples - 1 && samples > 1) {
+          row[c] *= sampleWeight;
+        }
+      }
+    }
+  }
+}
+
+RefitStats setAnimationTime(float seconds);
+
+/**
+ * @brief Traces a whole frame, first moving the animation on if the frame is
+ * for a later time. Runs on the render thread.
+ *
+ * @param view
+ * @param divisions
+ * @param samples
+ * @param seconds Time in the animation.
+ * @param target Receives the frame.
+ */
+void renderFrame(const Camera &view, int divisions, int samples,
+                 float seconds, Framebuffer *target) {
+  if (seconds != sceneSeconds) {
+    setAnimationTime(seconds);
+  }
+  TimelineZone zone("Trace frame");
+  Tile whole = {0, 0, divisions, divisions};
+  target->resize(divisions, divisions);
+  renderTile(view, whole, divisions, samples, target->pixels.data());
+}
+
+/**
+ * @brief Asks the render thread for a frame from the current camera, at the
+ * resolution and samples per cell chosen by `resolution`.
+ *
+ */
+void requestFrame() {
+  renderThread->request(camera, resolution.getDivisions(),
+                        resolution.getSamples(), animationSeconds);
+}
+
+/**
+ * @brief The main display module. It only copies the most recently traced
+ * frame to the window, so redrawing never traces the scene again. A lower
+ * resolution is upscaled for display.
+ *
+ */
+void display() {
+  TimelineZone zone("Present");
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  renderThread->withFront([](const Framebuffer &front) {
+    if (front.width == 0) {
+      return; // The first frame is still being traced
+    }
+    glRasterPos2f(XMIN, YMIN);
+    glPixelZoom((float)glutGet(GLUT_WINDOW_WIDTH) / front.width,
+                (float)glutGet(GLUT_WINDOW_HEIGHT) / front.height);
+    glDrawPixels(front.width, front.height, GL_RGB, GL_FLOAT,
+                 front.pixels.data());
+  });
+
+  glFlush();
+}
+
+/**
+ * @brief Periodically checks whether the render thread has finished a frame,
+ * and if so shows it.
+ *
+ * @param value Unused.
+ */
+void pollFrames(int value) {
+  FrameStats stats;
+  if (renderThread->takeFrame(&stats)) {
+    resolution.frameRendered(stats.frameMs, stats.divisions, stats.samples);
+    glutPostRedisplay();
+    if (sharedFrame.isOpen()) {
+      renderThread->withFront(
+          [](const Framebuffer &front) { sharedFrame.publish(front); });
+    }
+
+    // Each finished frame asks for the next one at the current time. The
+    // render thread moves the scene before tracing it, and the resolution
+    // follows the camera alone, so a still camera keeps full quality
+    if (!animatedObjects.empty() && animationPlaying) {
+      chrono::steady_clock::time_point now = chrono::steady_clock::now();
+      chrono::duration<float> elapsed = now - animationTick;
+      animationTick = now;
+      animationSeconds += elapsed.count();
+      requestFrame();
+    }
+  }
+  glutTimerFunc(FRAME_POLL_MS, pollFrames, 0);
+}
+
+/**
+ * @brief Adds an object which is part of the animation to the scene. With
+ * `animateScene`, the object must be built around the origin, and is added as
+ * an instance at `position` with the object's material, so that it can be
+ * moved. Otherwise the object must already be at `position`, and is added as
+ * it is.
+ *
+ * @param object
+ * @param position
+ */
+void addAnimated(SceneObject *object, glm::vec3 position) {
+  if (!animateScene) {
+    sceneObjects.push_back(object);
+    return;
+  }
+
+  Prototype *prototype = sceneArena.create<Prototype>();
+  prototype->parts.push_back(object);
+  prototype->build();
+  Instance *instance = sceneArena.create<Instance>(
+      prototype, position, glm::vec3(1), 0, object->getColor());
+  instance->setReflectivity(object->getReflectivity());
+  instance->setRefractive(object->isRefractive());
+  instance->setTransparent(object->isTransparent());
+  instance->setPattern(object->getPattern(), object->getTexture());
+
+  AnimatedObject animated = {instance, (int)sceneObjects.size(), position};
+  animatedObjects.push_back(animated);
+  sceneObjects.push_back(instance);
+}
+
+/**
+ * @brief Fills the back of the floor with a grid of crates and pyramids. Each
+ * shape is a prototype stored once in the arena, and every crate or pyramid is
+ * an instance of it with its own position, size, rotation and color.
+ *
+ */
+void addCrates() {
+  Prototype *crate = sceneArena.create<Prototype>();
+  drawCube(0, 0.5, 0, 1, 1, 1, glm::vec3(1), &sceneArena, &crate->parts);
+  crate->build();
+
+  Prototype *pyramid = sceneArena.create<Prototype>();
+  drawTetrahedron(0, 0, 0, glm::vec3(1), &sceneArena, &pyramid->parts);
+  pyramid->build();
+
+  for (int row = 0; row < 12; row++) {
+    for (int column = 0; column < 13; column++) {
+      glm::vec3 position(-18 + column * 3, -20, -166 - row * 3);
+      float turn = (row * 13 + column) * 0.7f;
+      glm::vec3 color(0.4 + 0.05 * (column % 7), 0.3 + 0.04 * (row % 9),
+                      0.2 + 0.1 * ((row + column) % 3));
+      SceneObject *object;
+      if ((row + column) % 4 == 0) {
+        object = sceneArena.create<Instance>(pyramid, position, glm::vec3(0.5),
+                                             turn, color);
+      } else {
+        float size = 1.5 + 0.25 * ((row * column) % 3);
+        object = sceneArena.create<Instance>(crate, position, glm::vec3(size),
+                                             turn, color);
+      }
+      sceneObjects.push_back(object);
+    }
+  }
+}
+
+/**
+ * @brief Lines the sides of the floor with two facing mirrors, so that rays
+ * bounce between them many times.
+ *
+ */
+void addMirrors() {
+  glm::vec3 tint(0.2, 0.2, 0.25);
+  Plane *left = sceneArena.create<Plane>(
+      glm::vec3(-20, -20, -40), glm::vec3(-20, -20, -200),
+      glm::vec3(-20, 20, -200), glm::vec3(-20, 20, -40), tint);
+  left->setReflectivity(0.9);
+  sceneObjects.push_back(left);
+
+  Plane *right = sceneArena.create<Plane>(
+      glm::vec3(20, -20, -200), glm::vec3(20, -20, -40),
+      glm::vec3(20, 20, -40), glm::vec3(20, 20, -200), tint);
+  right->setReflectivity(0.9);
+  sceneObjects.push_back(right);
+}
+
+/**
+ * @brief Traces photons through the scene for its caustics, if `photonCount`
+ * is set.
+ *
+ */
+void buildCausticMap() {
+  causticMap.clear();
+  if (photonCount > 0) {
+    TimelineZone photonZone("Build photon map");
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    PhotonOptics optics = {ETA, 1 - TRANSPARENCY};
+    causticMap.build(sceneObjects, sceneBVH, lights, NUM_LIGHTS, photonCount,
+                     CAUSTIC_RADIUS, optics);
+    chrono::duration<float, milli> buildTime =
+        chrono::steady_clock::now() - start;
+    cout << "Photon map: " << causticMap.size() << " photons stored in "
+         << buildTime.count() << " ms" << endl;
+  }
+}
+
+/**
+ * @brief This function initializes the scene.
+ * Specifically, it creates scene objects (spheres, planes, cones, cylinders
+ * etc.) in the scene arena, and adds them to the list of scene objects.
+ */
+void initializeScene() {
+  TimelineZone zone("Build scene");
+  animatedObjects.clear();
+  sceneSeconds = 0;
 
   // index 0
-  Sphere *sphere1 =
-      new Sphere(glm::vec3(-5.0, -5.0, -150.0), 15.0, glm::vec3(0, 0, 1));
+  Sphere *sphere1 = sceneArena.create<Sphere>(glm::vec3(-5.0, -5.0, -150.0),
+                                              15.0, glm::vec3(0, 0, 1));
+  sphere1->setReflectivity(0.8);
   sceneObjects.push_back(sphere1);
 
   // index 1
-  Sphere *sphere2 =
-      new Sphere(glm::vec3(10.0, 5.0, -130.0), 4.0, glm::vec3(1, 1, 0));
+  Sphere *sphere2 = sceneArena.create<Sphere>(glm::vec3(10.0, 5.0, -130.0),
+                                              4.0, glm::vec3(1, 1, 0));
   sceneObjects.push_back(sphere2);
 
   // index 2
-  Sphere *sphere3 =
-      new Sphere(glm::vec3(-10.0, -8.0, -60.0), 5.0, glm::vec3(0, 1, 0));
+  Sphere *sphere3 = sceneArena.create<Sphere>(glm::vec3(-10.0, -8.0, -60.0),
+                                              5.0, glm::vec3(0, 1, 0));
+  sphere3->setRefractive(true);
   sceneObjects.push_back(sphere3);
 
   // index 3
-  Plane *plane =
-      new Plane(glm::vec3(-20.0, -20, -40), glm::vec3(20.0, -20, -40),
-                glm::vec3(20.0, -20, -200), glm::vec3(-20.0, -20, -200),
-                glm::vec3(1.0, 1.0, 1.0));
+  Plane *plane = sceneArena.create<Plane>(
+      glm::vec3(-20.0, -20, -40), glm::vec3(20.0, -20, -40),
+      glm::vec3(20.0, -20, -200), glm::vec3(-20.0, -20, -200),
+      glm::vec3(1.0, 1.0, 1.0));
+  plane->setPattern(PATTERN_CHECKERS);
   sceneObjects.push_back(plane);
 
   // index 4
-  Cylinder *cylinder = new Cylinder(glm::vec3(8, -15, -100), 2, 8.0,
-                                    glm::vec3(0.27, 0.85, 0.91));
-  sceneObjects.push_back(cylinder);
+  glm::vec3 cylinderBase(8, -15, -100);
+  Cylinder *cylinder = sceneArena.create<Cylinder>(
+      animateScene ? glm::vec3(0) : cylinderBase, 2, 8.0,
+      glm::vec3(0.27, 0.85, 0.91));
+  addAnimated(cylinder, cylinderBase);
 
   // index 5
-  Cone *cone =
-      new Cone(glm::vec3(5, -15, -70), 2, 8.0, glm::vec3(0.341, 0.756, 0.490));
+  Cone *cone = sceneArena.create<Cone>(glm::vec3(5, -15, -70), 2, 8.0,
+                                       glm::vec3(0.341, 0.756, 0.490));
+  cone->setTransparent(true);
   sceneObjects.push_back(cone);
 
-  // index 6 - 11 (inclusive)
-  drawCube(-8, -10, -90, 5, 5, 5, glm::vec3(0.15, 0.77, 0.4), &sceneObjects);
+  // index 6
+  drawCube(-8, -10, -90, 5, 5, 5, glm::vec3(0.15, 0.77, 0.4), &sceneArena,
+           &sceneObjects);
 
-  // index 12 - 15 (inclusive)
-  drawTetrahedron(-3, -15, -90, glm::vec3(0.996, 0.184, 0.184), &sceneObjects);
+  // index 7
+  drawTetrahedron(-3, -15, -90, glm::vec3(0.996, 0.184, 0.184), &sceneArena,
+                  &sceneObjects);
 
-  // index 16
-  Sphere *sphere4 = new Sphere(earthCenter, 2.0, glm::vec3(0, 1, 0));
-  sceneObjects.push_back(sphere4);
+  // index 8
+  Sphere *sphere4 = sceneArena.create<Sphere>(
+      animateScene ? glm::vec3(0) : earthCenter, 2.0, glm::vec3(0, 1, 0));
+  sphere4->setPattern(PATTERN_TEXTURE, &earthTexture);
+  addAnimated(sphere4, earthCenter);
 
-  // index 17
-  Sphere *sphere5 = new Sphere(glm::vec3(8.0, -8.0, -60.0), 2.0,
-                               glm::vec3(0.901, 0.941, 0.156));
+  // index 9
+  Sphere *sphere5 = sceneArena.create<Sphere>(
+      glm::vec3(8.0, -8.0, -60.0), 2.0, glm::vec3(0.901, 0.941, 0.156));
+  sphere5->setPattern(PATTERN_STRIPES);
   sceneObjects.push_back(sphere5);
 
-  earthTexture = TextureBMP("textures/earth.bmp");
+  if (sceneName == "crates") {
+    addCrates();
+  } else if (sceneName == "mirrors") {
+    addMirrors();
+  }
+
+  if (!earthTextureLoaded) {
+    TimelineZone textureZone("Load texture");
+    earthTexture = TextureBMP("textures/earth.bmp");
+    earthTextureLoaded = true;
+  }
+  {
+    TimelineZone bvhZone("Build BVH");
+    sceneBVH.build(sceneObjects);
+  }
+  primaryVisibility.invalidate();
+  sceneGeneration++;
+
+  buildCausticMap();
+  selectTraceKernel();
+}
+
+/**
+ * @brief Destroys every object in the scene in one go, and builds the scene
+ * again in the same arena memory.
+ *
+ */
+void reloadScene() {
+  if (renderThread != NULL) {
+    renderThread->waitIdle();
+  }
+  sceneObjects.clear();
+  sceneArena.clear();
+  initializeScene();
+
+  cout << "Scene memory:" << endl;
+  sceneArena.report(cout);
+}
+
+/**
+ * @brief Builds a scene for the render server, unless it is already built.
+ *
+ * @param scene "default", "crates" or "mirrors".
+ * @return true The scene is ready.
+ * @return false There is no scene of that name.
+ */
+bool loadScene(const string &scene) {
+  if (scene != "default" && scene != "crates" && scene != "mirrors") {
+    return false;
+  }
+  if (scene == sceneName && !sceneObjects.empty()) {
+    return true;
+  }
+  sceneName = scene;
+  sceneObjects.clear();
+  sceneArena.clear();
+  initializeScene();
+  return true;
+}
+
+/**
+ * @brief Moves the animated objects to where they are `seconds` into the
+ * animation: the earth bobs and circles above the scene, and the cylinder
+ * slides from side to side. The BVH is refitted for the moved objects only,
+ * and everything cached for the old positions is dropped. The scene must not
+ * be traced while it moves.
+ *
+ * @param seconds
+ * @return RefitStats What refitting the BVH took.
+ */
+RefitStats setAnimationTime(float seconds) {
+  TimelineZone zone("Move objects");
+  vector<int> moved;
+  for (size_t i = 0; i < animatedObjects.size(); i++) {
+    AnimatedObject &object = animatedObjects[i];
+    float phase = seconds * 2 * M_PI / 4;
+    glm::vec3 offset = i == 0 ? glm::vec3(6 * sinf(phase), 0, 0)
+                              : glm::vec3(3 * sinf(phase), sinf(2 * phase),
+                                          3 * cosf(phase) - 3);
+    object.instance->setTransform(object.rest + offset, glm::vec3(1), 0);
+    moved.push_back(object.index);
+  }
+  sceneSeconds = seconds;
+
+  RefitStats stats = sceneBVH.refit(sceneObjects, moved);
+  primaryVisibility.invalidate();
+  sceneGeneration++;
+  buildCausticMap();
+  return stats;
+}
+
+/**
+ * @brief Called whenever the camera has been moved. Drops to a lower
+ * resolution until the camera settles.
+ *
+ */
+void cameraMoved() {
+  lastMoveTime = chrono::steady_clock::now();
+  if (!resolution.isMoving()) {
+    resolution.setMoving(true);
+  }
+  requestFrame();
+}
+
+/**
+ * @brief Periodically checks whether the camera has stopped moving, and if so
+ * redraws the scene at full quality.
+ *
+ * @param value Unused.
+ */
+void settleTimer(int value) {
+  if (resolution.isMoving()) {
+    chrono::duration<float, milli> sinceMove =
+        chrono::steady_clock::now() - lastMoveTime;
+    if (sinceMove.count() >= SETTLE_MS) {
+      resolution.setMoving(false);
+      requestFrame();
+    }
+  }
+  glutTimerFunc(SETTLE_MS / 5, settleTimer, 0);
+}
+
+/**
+ * @brief Moves the camera. `w`/`s` move forwards/backwards, `a`/`d` move
+ * left/right and `r`/`f` move up/down. `l` reloads the scene, and `p` pauses
+ * or resumes the animation.
+ *
+ * @param key
+ * @param x
+ * @param y
+ */
+void keyboard(unsigned char key, int x, int y) {
+  if (key == 'l') {
+    reloadScene();
+    requestFrame();
+    return;
+  }
+  if (key == 'p' && !animatedObjects.empty()) {
+    // The animation resumes from where it was paused
+    animationPlaying = !animationPlaying;
+    animationTick = chrono::steady_clock::now();
+    requestFrame();
+    return;
+  }
+
+  switch (key) {
+    case 'w':
+      camera.move(MOVE_STEP, 0, 0);
+      break;
+    case 's':
+      camera.move(-MOVE_STEP, 0, 0);
+      break;
+    case 'a':
+      camera.move(0, -MOVE_STEP, 0);
+      break;
+    case 'd':
+      camera.move(0, MOVE_STEP, 0);
+      break;
+    case 'r':
+      camera.move(0, 0, MOVE_STEP);
+      break;
+    case 'f':
+      camera.move(0, 0, -MOVE_STEP);
+      break;
+    default:
+      return;
+  }
+  cameraMoved();
+}
+
+/**
+ * @brief Rotates the camera with the arrow keys.
+ *
+ * @param key
+ * @param x
+ * @param y
+ */
+void special(int key, int x, int y) {
+  switch (key) {
+    case GLUT_KEY_LEFT:
+      camera.rotate(-ROTATE_STEP, 0);
+      break;
+    case GLUT_KEY_RIGHT:
+      camera.rotate(ROTATE_STEP, 0);
+      break;
+    case GLUT_KEY_UP:
+      camera.rotate(0, ROTATE_STEP);
+      break;
+    case GLUT_KEY_DOWN:
+      camera.rotate(0, -ROTATE_STEP);
+      break;
+    default:
+      return;
+  }
+  cameraMoved();
+}
+
+/**
+ * @brief Starts or stops rotating the camera by dragging with the left mouse
+ * button.
+ *
+ * @param button
+ * @param state
+ * @param x
+ * @param y
+ */
+void mouse(int button, int state, int x, int y) {
+  if (button != GLUT_LEFT_BUTTON) {
+    return;
+  }
+  dragging = state == GLUT_DOWN;
+  dragX = x;
+  dragY = y;
+}
+
+/**
+ * @brief Rotates the camera while the left mouse button is held down.
+ *
+ * @param x
+ * @param y
+ */
+void motion(int x, int y) {
+  if (!dragging) {
+    return;
+  }
+  camera.rotate((x - dragX) * MOUSE_SENSITIVITY,
+                (dragY - y) * MOUSE_SENSITIVITY);
+  dragX = x;
+  dragY = y;
+  cameraMoved();
+}
+
+/**
+ * @brief Stops the render thread before the scene is destroyed at exit.
+ *
+ */
+void stopRenderThread() {
+  delete renderThread;
+  renderThread = NULL;
+}
+
+/**
+ * @brief Writes the timeline to `timelineFile` as the program exits.
+ *
+ */
+void saveTimeline() { writeTimeline(timelineFile); }
+
+/**
+ * @brief Initializes the scene, and the OpenGL othographic projection matrix
+ * for drawing the ray traced image. Then starts tracing the first frame in the
+ * background.
+ */
+void initialize() {
+  glMatrixMode(GL_PROJECTION);
+  gluOrtho2D(XMIN, XMAX, YMIN, YMAX);
+  glClearColor(0, 0, 0, 1);
+
+  initializeScene();
+
+  renderThread = new RenderThread(renderFrame);
+  atexit(stopRenderThread);
+  requestFrame();
+}
+
+/**
+ * @brief Milliseconds from now until a point in time, negative once it has
+ * passed.
+ *
+ * @param when
+ * @return float
+ */
+float millisecondsUntil(chrono::steady_clock::time_point when) {
+  chrono::duration<float, milli> left = when - chrono::steady_clock::now();
+  return left.count();
+}
+
+/**
+ * @brief Traces a complete image by a deadline, on the calling thread. Every
+ * tile is first probed with one ray per `PROBE_STRIDE` square of cells, and
+ * then traced again at the quality `planner` can afford, up to that of
+ * `options`. Tiles that can't be afforded keep their probed pixels.
+ *
+ * @param options
+ * @param tiles
+ * @param deadline When the tiles must be finished.
+ * @param planner Chooses the level of each tile, and reports the result.
+ * @param sink Receives every probed and traced tile.
+ */
+void traceWithinBudget(const Options &options, const vector<Tile> &tiles,
+                       chrono::steady_clock::time_point deadline,
+                       DeadlinePlanner *planner, TileSink *sink) {
+  int divisions = options.divisions;
+  int probeDivisions = (divisions + PROBE_STRIDE - 1) / PROBE_STRIDE;
+  vector<glm::vec3> pixels(options.tileSize * options.tileSize);
+  vector<glm::vec3> probe;
+
+  {
+    TimelineZone probeZone("Probe tiles");
+    for (size_t t = 0; t < tiles.size(); t++) {
+      const Tile &tile = tiles[t];
+      Tile coarse;
+      coarse.x = tile.x * probeDivisions / divisions;
+      coarse.y = tile.y * probeDivisions / divisions;
+      coarse.width =
+          (tile.x + tile.width - 1) * probeDivisions / divisions - coarse.x + 1;
+      coarse.height = (tile.y + tile.height - 1) * probeDivisions / divisions -
+                      coarse.y + 1;
+      probe.resize(coarse.width * coarse.height);
+
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      renderTile(camera, coarse, probeDivisions, 1, probe.data());
+      chrono::duration<float, milli> probeTime =
+          chrono::steady_clock::now() - start;
+      planner->probed(t, tile.width * tile.height, probeTime.count(),
+                      coarse.width * coarse.height);
+
+      for (int j = 0; j < tile.height; j++) {
+        int row = (tile.y + j) * probeDivisions / divisions - coarse.y;
+        for (int i = 0; i < tile.width; i++) {
+          int column = (tile.x + i) * probeDivisions / divisions - coarse.x;
+          pixels[j * tile.width + i] = probe[row * coarse.width + column];
+        }
+      }
+      sink->setTile(tile, pixels.data());
+    }
+  }
+
+  for (size_t t = 0; t < tiles.size(); t++) {
+    int level = planner->chooseLevel(millisecondsUntil(deadline));
+    if (level < 0) {
+      planner->traced(-1);
+      continue;
+    }
+    const QualityLevel &quality = planner->getLevel(level);
+    maxDepth = quality.maxDepth;
+    lightRadius = quality.softShadows ? options.lightRadius : 0;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    renderTile(camera, tiles[t], divisions, quality.samples, pixels.data());
+    chrono::duration<float, milli> tileTime =
+        chrono::steady_clock::now() - start;
+    sink->setTile(tiles[t], pixels.data());
+    planner->traced(tileTime.count());
+  }
+  maxDepth = options.maxDepth;
+  lightRadius = options.lightRadius;
+}
+
+/**
+ * @brief Traces every tile of a headless render and passes it to `sink`, with
+ * worker processes, threads or on the calling thread as `options` asks.
+ *
+ * @param options
+ * @param tiles
+ * @param sink
+ * @param report Whether to print the statistics of the render.
+ * @return true The image was traced.
+ * @return false The workers could not be started.
+ */
+bool traceTiles(const Options &options, const vector<Tile> &tiles,
+                TileSink *sink, bool report) {
+  if (options.workers > 0) {
+    string socketPath;
+    if (options.socketPath != NULL) {
+      socketPath = options.socketPath;
+    } else {
+      socketPath = "/tmp/raytracer-" + to_string(getpid()) + ".sock";
+    }
+
+    TileCoordinator coordinator(socketPath.c_str(),
+                                describeRenderSettings(options));
+    if (!coordinator.listen()) {
+      return false;
+    }
+    coordinator.spawnLocalWorkers(options.workers, renderTile);
+    coordinator.render(camera, options.divisions, options.samples, tiles,
+                       renderTile, sink);
+  } else if (options.threads > 1 || options.pinThreads) {
+    // The caches and counts are per thread, so only the placement of the
+    // threads is reported
+    TilePool pool(options.threads, options.pinThreads);
+    preparePrimaryVisibility(camera, options.divisions);
+    pool.render(camera, options.divisions, options.samples, tiles, renderTile,
+                sink);
+    if (report) {
+      cout << "Threads:" << endl;
+      pool.report(cout);
+    }
+  } else {
+    size_t largestTile = 0;
+    for (size_t t = 0; t < tiles.size(); t++) {
+      largestTile = max(largestTile, (size_t)tiles[t].width * tiles[t].height);
+    }
+    vector<glm::vec3> pixels(largestTile);
+    preparePrimaryVisibility(camera, options.divisions);
+    prepareThreadCaches();
+    size_t allocationsBefore = heapAllocations();
+    for (size_t t = 0; t < tiles.size(); t++) {
+      renderTile(camera, tiles[t], options.divisions, options.samples,
+                 pixels.data());
+      sink->setTile(tiles[t], pixels.data());
+    }
+    if (!report) {
+      return true;
+    }
+    cout << "Heap allocations while tracing: "
+         << heapAllocations() - allocationsBefore << endl;
+    if (sceneShadows) {
+      cout << "Shadow occluder cache:" << endl;
+      shadowCache.report(cout);
+    }
+    if (lightingCache.isEnabled()) {
+      cout << "Lighting cache:" << endl;
+      lightingCache.report(cout);
+    }
+    cout << "Secondary rays:" << endl;
+    pathStats.report(cout);
+    if (rasterPrimary) {
+      cout << "Objects tested per primary ray: "
+           << primaryVisibility.averageCandidates() << " of "
+           << sceneObjects.size() << endl;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Prints which lighting kernels shade the scene. Only fast math has a
+ * kernel per instruction set; exact math is shaded one point at a time by the
+ * same code on every processor.
+ *
+ */
+void printKernels() {
+  if (mathMode == MATH_FAST) {
+    cout << "Kernels: " << isaName(kernelIsa) << " (fast-math lighting only)"
+         << endl;
+  } else {
+    cout << "Kernels: scalar (exact math)" << endl;
+  }
+}
+
+/**
+ * @brief Renders the scene without opening a window, and writes it to
+ * `options.outputFile`. With workers, the tiles of the image are traced by
+ * worker processes.
+ *
+ * @param options
+ * @return int The process exit status.
+ */
+int renderHeadless(const Options &options) {
+  // Standard output carries the image, so the report goes to standard error
+  if (strcmp(options.outputFile, "-") == 0) {
+    cout.rdbuf(cerr.rdbuf());
+  }
+  chrono::steady_clock::time_point launched = chrono::steady_clock::now();
+
+  initializeScene();
+  cout << "Scene memory:" << endl;
+  sceneArena.report(cout);
+  printKernels();
+
+  // A streamed image is written from the top row down, so its tiles are
+  // traced in that order to keep few of them waiting
+  Framebuffer image;
+  PPMStream stream(options.divisions, options.divisions);
+  TileSink *sink = &image;
+  if (options.stream) {
+    if (!stream.open(options.outputFile)) {
+      return 1;
+    }
+    sink = &stream;
+  } else {
+    image.resize(options.divisions, options.divisions);
+  }
+  vector<Tile> tiles =
+      splitIntoTiles(options.divisions, options.divisions, options.tileSize,
+                     options.order, options.stream);
+  cout << "Order: " << tileOrderName(options.order) << endl;
+  if (options.sharedName != NULL &&
+      !sharedFrame.open(options.sharedName, options.divisions,
+                        options.divisions)) {
+    return 1;
+  }
+
+  PerfCounters counters;
+  counters.start();
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  // Earlier frames of an animation are traced into a scratch image
+  Framebuffer scratch;
+  if (options.frames > 1) {
+    scratch.resize(options.divisions, options.divisions);
+  }
+  float updateMs = 0;
+  RefitStats refits = {0, 0, 0};
+  DeadlinePlanner planner(options.samples, options.maxDepth,
+                          options.shadows && options.lightRadius > 0);
+  chrono::steady_clock::time_point deadline =
+      launched + chrono::microseconds((long long)(options.budgetMs * 1000 *
+                                                  (1 - WRITE_RESERVE)));
+  for (int frame = 0; frame < options.frames; frame++) {
+    if (animateScene) {
+      chrono::steady_clock::time_point updateStart =
+          chrono::steady_clock::now();
+      RefitStats stats = setAnimationTime(frame * FRAME_SECONDS);
+      chrono::duration<float, milli> updateTime =
+          chrono::steady_clock::now() - updateStart;
+      updateMs += updateTime.count();
+      refits.nodesRefitted += stats.nodesRefitted;
+      refits.subtreesRebuilt += stats.subtreesRebuilt;
+      refits.objectsRebuilt += stats.objectsRebuilt;
+    }
+    bool last = frame == options.frames - 1;
+    TileSink *frameSink = last ? sink : &scratch;
+
+    // Every frame is published tile by tile, and passed on to be written
+    if (sharedFrame.isOpen()) {
+      sharedFrame.forwardTo(frameSink);
+      sharedFrame.beginFrame(options.divisions, options.divisions);
+      frameSink = &sharedFrame;
+    }
+    if (options.budgetMs > 0) {
+      traceWithinBudget(options, tiles, deadline, &planner, frameSink);
+    } else if (!traceTiles(options, tiles, frameSink, last)) {
+      return 1;
+    }
+    if (sharedFrame.isOpen()) {
+      sharedFrame.endFrame();
+    }
+  }
+
+  chrono::duration<float, milli> renderTime =
+      chrono::steady_clock::now() - start;
+  counters.stop();
+  cout << "Rendered in " << renderTime.count() << " ms" << endl;
+  if (options.budgetMs > 0) {
+    cout << "Quality within " << options.budgetMs << " ms:" << endl;
+    planner.report(cout);
+  }
+  counters.report(cout);
+  // Within a budget, tiles are traced at fewer samples, or not at all
+  double primaryRays =
+      options.budgetMs > 0
+          ? planner.getPrimaryRays()
+          : (double)options.divisions * options.divisions * options.samples;
+  cout << "Primary rays: " << 1000.0 * primaryRays / renderTime.count()
+       << " per second" << endl;
+  if (options.frames > 1) {
+    cout << "Frames: " << options.frames << ", "
+         << renderTime.count() / options.frames << " ms each" << endl;
+  }
+  if (animateScene) {
+    // A full rebuild, for comparison with refitting
+    chrono::steady_clock::time_point buildStart = chrono::steady_clock::now();
+    BVH rebuilt;
+    rebuilt.build(sceneObjects);
+    chrono::duration<float, milli> buildTime =
+        chrono::steady_clock::now() - buildStart;
+    cout << "Scene updates: " << 1000 * updateMs / options.frames
+         << " us per frame for " << animatedObjects.size() << " moved of "
+         << sceneObjects.size() << " objects, "
+         << (float)refits.nodesRefitted / options.frames
+         << " BVH nodes refitted and " << refits.subtreesRebuilt
+         << " subtrees rebuilt (" << refits.objectsRebuilt
+         << " objects) in total; a full BVH build takes "
+         << 1000 * buildTime.count() << " us" << endl;
+  }
+  cout << "Ray: " << sizeof(Ray) << " bytes, hit record: " << sizeof(Hit)
+       << " bytes" << endl;
+
+  if (options.referenceFile != NULL) {
+    Framebuffer reference;
+    ImageDifference difference;
+    if (!reference.readPPM(options.referenceFile) ||
+        !compareImages(image, reference, max(options.tolerance, 0),
+                       &difference)) {
+      cerr << "Could not compare with " << options.referenceFile << endl;
+      return 1;
+    }
+    cout << "Difference from reference: max " << difference.maxDifference
+         << ", mean " << difference.meanDifference << ", bias "
+         << difference.meanBias << ", PSNR "
+         << difference.psnr << " dB, " << difference.differentChannels
+         << " channels differ" << endl;
+
+    if (options.tolerance >= 0 && difference.pixelsOver > 0) {
+      cerr << difference.pixelsOver << " pixels differ by more than "
+           << options.tolerance << endl;
+      if (options.heatmapFile != NULL) {
+        Framebuffer heatmap;
+        differenceHeatmap(image, reference, options.tolerance, &heatmap);
+        heatmap.writePPM(options.heatmapFile);
+      }
+      image.writePPM(options.outputFile);
+      return 1;
+    }
+  }
+
+  if (options.stream) {
+    cout << "Streamed with at most " << stream.peakBytes() / 1024
+         << " KB of tiles waiting for their rows" << endl;
+    return stream.finish() ? 0 : 1;
+  }
+  TimelineZone writeZone("Write image");
+  bool written = image.writePPM(options.outputFile);
+  if (options.budgetMs > 0) {
+    chrono::duration<float, milli> elapsed =
+        chrono::steady_clock::now() - launched;
+    bool met = elapsed.count() <= options.budgetMs;
+    cout << "Image written " << elapsed.count() << " ms after the render "
+         << "began, " << (met ? "within" : "over") << " the "
+         << options.budgetMs << " ms budget" << endl;
+  }
+  return written ? 0 : 1;
+}
+
+/**
+ * @brief Renders several views of the scene without opening a window, and
+ * writes each to its own image named after `options.outputFile`. The scene,
+ * its acceleration structures, the texture and the photon map are built once
+ * and shared by every view. The shadow and lighting caches are only reused
+ * from one view to the next on the calling thread, since `traceTiles()`
+ * starts new threads or workers for each view.
+ *
+ * @param options
+ * @return int The process exit status.
+ */
+int renderViews(const Options &options) {
+  chrono::steady_clock::time_point buildStart = chrono::steady_clock::now();
+  initializeScene();
+  chrono::duration<float, milli> buildTime =
+      chrono::steady_clock::now() - buildStart;
+  cout << "Scene built in " << buildTime.count() << " ms" << endl;
+  printKernels();
+
+  vector<View> views = makeViews(options.views, camera, options.viewCount,
+                                 options.viewSpacing);
+  vector<Tile> tiles =
+      splitIntoTiles(options.divisions, options.divisions, options.tileSize,
+                     options.order);
+  Framebuffer image(options.divisions, options.divisions);
+  Camera center = camera;
+  float totalMs = 0;
+
+  for (size_t v = 0; v < views.size(); v++) {
+    camera = views[v].camera;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (!traceTiles(options, tiles, &image, v == views.size() - 1)) {
+      return 1;
+    }
+    chrono::duration<float, milli> viewTime =
+        chrono::steady_clock::now() - start;
+    totalMs += viewTime.count();
+
+    string file = viewFileName(options.outputFile, views[v].name);
+    TimelineZone writeZone("Write image");
+    if (!image.writePPM(file.c_str())) {
+      return 1;
+    }
+    cout << "View " << views[v].name << ": " << viewTime.count()
+         << " ms, written to " << file << endl;
+  }
+  camera = center;
+
+  cout << "Rendered " << views.size() << " " << viewSetName(options.views)
+       << " views in " << totalMs << " ms, sharing one scene built in "
+       << buildTime.count() << " ms" << endl;
+  return 0;
 }
 
 int main(int argc, char *argv[]) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  mathMode = options.fastMath ? MATH_FAST : MATH_EXACT;
+
+  kernelIsa = detectIsa();
+  if (options.isaForced) {
+    if (options.isa > kernelIsa) {
+      cerr << "This processor does not support the " << isaName(options.isa)
+           << " kernels" << endl;
+      return 1;
+    }
+    kernelIsa = options.isa;
+  }
+  selectLightingKernels(kernelIsa);
+  sceneName = options.scene;
+  rasterPrimary = options.rasterPrimary;
+  lightCacheSpacing = options.lightCacheSpacing;
+  photonCount = options.photons;
+  sampler.setPattern(options.samplePattern);
+  lightRadius = options.lightRadius;
+  sceneShadows = options.shadows;
+  glossiness = options.glossiness;
+  maxDepth = options.maxDepth;
+  minContribution = options.minContribution;
+  russianRoulette = options.russianRoulette;
+  animateScene = options.animate;
+  animationTick = chrono::steady_clock::now();
+
+  // Registered before the render thread's exit handler, so it runs after the
+  // render thread has stopped
+  if (options.timelineFile != NULL) {
+    timelineFile = options.timelineFile;
+    startTimeline(TIMELINE_EVENTS);
+    nameTimelineThread("Main");
+    atexit(saveTimeline);
+  }
+
+  if (options.workerSocket != NULL) {
+    initializeScene();
+    return runWorker(options.workerSocket, describeRenderSettings(options),
+                     renderTile);
+  }
+
+  if (options.serveSocket != NULL) {
+    // Standard output carries only the answers to jobs read from standard
+    // input, so progress messages go to standard error
+    if (strcmp(options.serveSocket, "-") == 0) {
+      cout.rdbuf(cerr.rdbuf());
+    }
+    initializeScene();
+    RenderServer server(renderTile, loadScene, camera, options.divisions,
+                        options.samples, options.threads, options.tileSize);
+    return server.serve(options.serveSocket);
+  }
+
+  if (options.views != VIEWS_SINGLE) {
+    return renderViews(options);
+  }
+
+  if (options.outputFile != NULL) {
+    return renderHeadless(options);
+  }
+
+  if (options.sharedName != NULL &&
+      !sharedFrame.open(options.sharedName, NUMDIV, NUMDIV)) {
+    return 1;
+  }
+
   glutInit(&argc, argv);
   glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB);
   glutInitWindowSize(500, 500);
@@ -392,6 +2086,12 @@ int main(int argc, char *argv[]) {
   glutCreateWindow("Raytracer");
 
   glutDisplayFunc(display);
+  glutKeyboardFunc(keyboard);
+  glutSpecialFunc(special);
+  glutMouseFunc(mouse);
+  glutMotionFunc(motion);
+  glutTimerFunc(SETTLE_MS / 5, settleTimer, 0);
+  glutTimerFunc(FRAME_POLL_MS, pollFrames, 0);
   initialize();
 
   glutMainLoop();
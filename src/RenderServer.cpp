@@ -0,0 +1,466 @@
+#include "RenderServer.h"
+#include <algorithm>
+#include <errno.h>
+#include <new>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// How often the socket server checks whether it has been asked to stop
+const int ACCEPT_POLL_MS = 100;
+
+// The largest size and samples per cell a job may ask for. The size also keeps
+// the job's image, `size * size` pixels, well within what can be allocated
+const long MAX_JOB_DIVISIONS = 8192;
+const long MAX_JOB_SAMPLES = 4096;
+
+RenderServer::Client::~Client() {
+  if (isSocket) {
+    close(fd);
+  }
+}
+
+/**
+ * @brief Sends one line to the client. Lines from different threads are never
+ * interleaved, and a client which has gone away is ignored.
+ *
+ * @param line The line, without its newline.
+ */
+void RenderServer::Client::respond(const string &line) {
+  string text = line + "\n";
+  lock_guard<mutex> lock(writeMutex);
+  const char *data = text.data();
+  size_t left = text.size();
+  while (left > 0) {
+    ssize_t n = isSocket ? send(fd, data, left, MSG_NOSIGNAL)
+                         : write(fd, data, left);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return;
+    }
+    data += n;
+    left -= n;
+  }
+}
+
+/**
+ * @brief Creates a server. Nothing runs until `serve()`.
+ *
+ * @param renderer Traces one tile.
+ * @param loader Builds the scene a job asks for.
+ * @param view The camera each job's camera starts from.
+ * @param divisions The size of an image when a job does not give one.
+ * @param samples The samples per cell when a job does not give them.
+ * @param threads The number of threads in the pool.
+ * @param tiles The width and height of the tiles images are split into.
+ */
+RenderServer::RenderServer(TileRenderer renderer, SceneLoader loader,
+                           const Camera &view, int divisions, int samples,
+                           int threads, int tiles)
+    : render(renderer), loadScene(loader), baseCamera(view),
+      defaultDivisions(divisions), defaultSamples(samples),
+      threadCount(threads), tileSize(tiles), stopping(false), jobsDone(0) {}
+
+/**
+ * @brief Reads a `render` line into a job.
+ *
+ * @param line
+ * @param job Receives the job.
+ * @param error Receives what is wrong with the line, if it is invalid.
+ * @return true The line is a valid job.
+ * @return false The line is invalid.
+ */
+bool RenderServer::parseJob(const string &line, Job *job, string *error) {
+  istringstream words(line);
+  string command;
+  words >> command >> job->id;
+  if (job->id.empty()) {
+    *error = "missing job id";
+    return false;
+  }
+
+  job->scene = "default";
+  job->camera = baseCamera;
+  job->divisions = defaultDivisions;
+  job->samples = defaultSamples;
+  float yaw = 0;
+  float pitch = 0;
+
+  string word;
+  while (words >> word) {
+    size_t equals = word.find('=');
+    if (equals == string::npos) {
+      *error = "expected key=value: " + word;
+      return false;
+    }
+    string key = word.substr(0, equals);
+    const char *value = word.c_str() + equals + 1;
+    char *end;
+    bool valid = true;
+    if (key == "output") {
+      job->output = value;
+    } else if (key == "scene") {
+      job->scene = value;
+    } else if (key == "size" || key == "samples") {
+      long limit = key == "size" ? MAX_JOB_DIVISIONS : MAX_JOB_SAMPLES;
+      errno = 0;
+      long n = strtol(value, &end, 10);
+      valid = *end == '\0' && errno != ERANGE && n > 0;
+      if (valid && n > limit) {
+        *error = key + " is over " + to_string(limit) + ": " + value;
+        return false;
+      }
+      (key == "size" ? job->divisions : job->samples) = (int)n;
+    } else if (key == "yaw" || key == "pitch") {
+      (key == "yaw" ? yaw : pitch) = strtof(value, &end);
+      valid = *end == '\0';
+    } else if (key == "eye") {
+      glm::vec3 &eye = job->camera.eye;
+      valid = sscanf(value, "%f,%f,%f", &eye.x, &eye.y, &eye.z) == 3;
+    } else {
+      *error = "unknown key: " + key;
+      return false;
+    }
+    if (!valid) {
+      *error = "invalid value for " + key + ": " + value;
+      return false;
+    }
+  }
+
+  if (job->output.empty()) {
+    *error = "missing output=FILE";
+    return false;
+  }
+  job->camera.rotate(yaw, pitch);
+  return true;
+}
+
+/**
+ * @brief Acts on one line from a client.
+ *
+ * @param line
+ * @param client
+ * @return true The client may send more lines.
+ * @return false The line was `quit`.
+ */
+bool RenderServer::handleLine(const string &line,
+                              const shared_ptr<Client> &client) {
+  istringstream words(line);
+  string command;
+  words >> command;
+  if (command.empty()) {
+    return true;
+  }
+  if (command == "quit") {
+    stop();
+    return false;
+  }
+
+  shared_ptr<Job> job(new Job);
+  string error;
+  if (command != "render") {
+    client->respond("error - unknown command: " + command);
+    return true;
+  }
+  if (!parseJob(line, job.get(), &error)) {
+    client->respond("error " + (job->id.empty() ? "-" : job->id) + " " +
+                    error);
+    return true;
+  }
+  job->client = client;
+  job->received = chrono::steady_clock::now();
+
+  lock_guard<mutex> lock(stateMutex);
+  if (stopping) {
+    client->respond("error " + job->id + " server is stopping");
+    return true;
+  }
+  waiting.push_back(job);
+  wake.notify_all();
+  return true;
+}
+
+/**
+ * @brief Reads lines from a socket client until it disconnects or quits, then
+ * marks its reader done. The client's connection is closed once its last job
+ * has been answered.
+ *
+ * @param client
+ * @param reader The reader running this function.
+ */
+void RenderServer::serveClient(shared_ptr<Client> client, Reader *reader) {
+  string buffer;
+  char data[4096];
+  bool reading = true;
+  while (reading) {
+    ssize_t n = recv(client->fd, data, sizeof(data), 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    buffer.append(data, n);
+
+    size_t newline;
+    while (reading && (newline = buffer.find('\n')) != string::npos) {
+      string line = buffer.substr(0, newline);
+      buffer.erase(0, newline + 1);
+      reading = handleLine(line, client);
+    }
+  }
+
+  client.reset();
+  lock_guard<mutex> lock(stateMutex);
+  reader->done = true;
+}
+
+/**
+ * @brief Joins the readers whose clients have gone, so that a long running
+ * server holds no threads for them.
+ *
+ */
+void RenderServer::joinFinishedReaders() {
+  vector<thread> finished;
+  {
+    lock_guard<mutex> lock(stateMutex);
+    for (list<Reader>::iterator r = readers.begin(); r != readers.end();) {
+      if (r->done) {
+        finished.push_back(move(r->thread));
+        r = readers.erase(r);
+      } else {
+        ++r;
+      }
+    }
+  }
+  for (size_t t = 0; t < finished.size(); t++) {
+    finished[t].join();
+  }
+}
+
+/**
+ * @brief A pool thread's loop. Starts waiting jobs when it can, then traces
+ * the next tile of the oldest running job, until the server stops and every
+ * job is done.
+ *
+ */
+void RenderServer::work() {
+  vector<glm::vec3> pixels;
+  unique_lock<mutex> lock(stateMutex);
+  while (true) {
+    // Jobs for the current scene start straight away, and a job for another
+    // scene starts once everything before it has finished
+    while (!waiting.empty()) {
+      shared_ptr<Job> job = waiting.front();
+      if (job->scene != currentScene) {
+        if (!running.empty()) {
+          break;
+        }
+        if (!loadScene(job->scene)) {
+          // Answered without the lock, so a slow client holds up nobody else
+          waiting.pop_front();
+          lock.unlock();
+          job->client->respond("error " + job->id +
+                               " unknown scene: " + job->scene);
+          lock.lock();
+          continue;
+        }
+        currentScene = job->scene;
+      }
+      waiting.pop_front();
+      try {
+        job->image.resize(job->divisions, job->divisions);
+        job->tiles = splitIntoTiles(job->divisions, job->divisions, tileSize);
+      } catch (const bad_alloc &) {
+        lock.unlock();
+        job->client->respond("error " + job->id + " not enough memory for " +
+                             to_string(job->divisions) + "x" +
+                             to_string(job->divisions));
+        lock.lock();
+        continue;
+      }
+      job->nextTile = 0;
+      job->tilesLeft = job->tiles.size();
+      running.push_back(job);
+    }
+
+    shared_ptr<Job> job;
+    for (size_t j = 0; j < running.size() && !job; j++) {
+      if (running[j]->nextTile < running[j]->tiles.size()) {
+        job = running[j];
+      }
+    }
+
+    if (job) {
+      if (job->nextTile == 0) {
+        job->started = chrono::steady_clock::now();
+      }
+      Tile tile = job->tiles[job->nextTile++];
+      lock.unlock();
+      pixels.resize(max(pixels.size(), (size_t)tile.width * tile.height));
+      render(job->camera, tile, job->divisions, job->samples, pixels.data());
+      lock.lock();
+
+      job->image.setTile(tile, pixels.data());
+      if (--job->tilesLeft == 0) {
+        running.erase(find(running.begin(), running.end(), job));
+        lock.unlock();
+        finish(job);
+        lock.lock();
+        jobsDone++;
+        wake.notify_all();
+      }
+      continue;
+    }
+
+    if (stopping && waiting.empty() && running.empty()) {
+      return;
+    }
+    wake.wait(lock);
+  }
+}
+
+/**
+ * @brief Writes a finished job's image and answers its client.
+ *
+ * @param job
+ */
+void RenderServer::finish(const shared_ptr<Job> &job) {
+  if (!job->image.writePPM(job->output.c_str())) {
+    job->client->respond("error " + job->id + " could not write " +
+                         job->output);
+    return;
+  }
+
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  chrono::duration<float, milli> latency = now - job->received;
+  chrono::duration<float, milli> queued = job->started - job->received;
+  chrono::duration<float, milli> traced = now - job->started;
+  ostringstream line;
+  line << "done " << job->id << " " << latency.count() << " ms (queued "
+       << queued.count() << " ms, traced " << traced.count() << " ms)";
+  job->client->respond(line.str());
+  cerr << "Job " << job->id << ": " << job->divisions << "x"
+       << job->divisions << " of " << job->scene << " in " << latency.count()
+       << " ms" << endl;
+}
+
+/**
+ * @brief Asks the server to stop once every job it has been given is done.
+ *
+ */
+void RenderServer::stop() {
+  lock_guard<mutex> lock(stateMutex);
+  stopping = true;
+  wake.notify_all();
+}
+
+bool RenderServer::isStopping() {
+  lock_guard<mutex> lock(stateMutex);
+  return stopping;
+}
+
+/**
+ * @brief Serves jobs until told to quit.
+ *
+ * @param path The Unix domain socket to listen on, or "-" to read jobs from
+ * standard input and answer on standard output, stopping at the end of the
+ * input.
+ * @return int The process exit status.
+ */
+int RenderServer::serve(const char *path) {
+  vector<thread> pool;
+  for (int t = 0; t < threadCount; t++) {
+    pool.push_back(thread(&RenderServer::work, this));
+  }
+
+  int status = 0;
+  if (strcmp(path, "-") == 0) {
+    shared_ptr<Client> client(new Client(STDOUT_FILENO, false));
+    string line;
+    while (getline(cin, line) && handleLine(line, client)) {
+    }
+    stop();
+  } else {
+    status = serveSocket(path);
+  }
+
+  for (size_t t = 0; t < pool.size(); t++) {
+    pool[t].join();
+  }
+  cerr << "Served " << jobsDone << " jobs" << endl;
+  return status;
+}
+
+/**
+ * @brief Accepts clients on a Unix domain socket, each served by a thread of
+ * its own, until a client sends `quit`.
+ *
+ * @param path
+ * @return int The process exit status.
+ */
+int RenderServer::serveSocket(const char *path) {
+  int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+  unlink(path);
+  if (listenFd < 0 ||
+      bind(listenFd, (sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(listenFd, 16) != 0) {
+    cerr << "Could not listen on " << path << ": " << strerror(errno) << endl;
+    if (listenFd >= 0) {
+      close(listenFd);
+    }
+    stop();
+    return 1;
+  }
+  cerr << "Serving render jobs on " << path << endl;
+
+  while (!isStopping()) {
+    joinFinishedReaders();
+    pollfd ready = {listenFd, POLLIN, 0};
+    if (poll(&ready, 1, ACCEPT_POLL_MS) <= 0) {
+      continue;
+    }
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+    shared_ptr<Client> client(new Client(fd, true));
+    lock_guard<mutex> lock(stateMutex);
+    readers.push_back(Reader());
+    Reader *reader = &readers.back();
+    reader->client = client;
+    reader->done = false;
+    reader->thread = thread(&RenderServer::serveClient, this, client, reader);
+  }
+
+  // Wake the readers of clients which are still connected
+  {
+    lock_guard<mutex> lock(stateMutex);
+    for (list<Reader>::iterator r = readers.begin(); r != readers.end(); ++r) {
+      shared_ptr<Client> client = r->client.lock();
+      if (!r->done && client) {
+        shutdown(client->fd, SHUT_RD);
+      }
+    }
+  }
+  for (list<Reader>::iterator r = readers.begin(); r != readers.end(); ++r) {
+    r->thread.join();
+  }
+  readers.clear();
+  close(listenFd);
+  unlink(path);
+  return 0;
+}
@@ -0,0 +1,132 @@
+#ifndef H_RENDER_SERVER
+#define H_RENDER_SERVER
+
+#include "Camera.h"
+#include "Distributed.h"
+#include "Framebuffer.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Makes `scene` the scene that tiles are traced from, building it if it
+ * is not the current scene already.
+ *
+ * @return true The scene is ready.
+ * @return false There is no scene of that name.
+ */
+typedef bool (*SceneLoader)(const std::string &scene);
+
+/**
+ * @brief Serves render jobs for as long as it runs, so that the scene, the
+ * texture and the caches built for them are kept from one job to the next.
+ *
+ * Jobs arrive one per line, on standard input or from any number of clients
+ * connected to a Unix domain socket:
+ *
+ *     render ID output=FILE [scene=NAME] [size=N] [samples=N]
+ *            [eye=X,Y,Z] [yaw=R] [pitch=R]
+ *     quit
+ *
+ * Each job is answered on the line it came from, once its image has been
+ * written:
+ *
+ *     done ID LATENCY ms (queued Q ms, traced T ms)
+ *     error ID MESSAGE
+ *
+ * The tiles of every running job are traced by one shared pool of threads,
+ * which takes tiles from the oldest job first, so jobs run concurrently
+ * whenever the pool has threads to spare. Only one scene is built at a time:
+ * a job for another scene waits until the jobs before it have finished, and
+ * the scene is then rebuilt for it. `quit` stops the server once every job it
+ * has been given is done.
+ */
+class RenderServer {
+private:
+  /**
+   * @brief Where jobs came from, and where their answers go. The connection
+   * is closed once the client has gone and its last job is answered.
+   *
+   */
+  struct Client {
+    int fd;
+    bool isSocket;
+    std::mutex writeMutex;
+
+    Client(int descriptor, bool socket) : fd(descriptor), isSocket(socket) {}
+    ~Client();
+
+    void respond(const std::string &line);
+  };
+
+  /**
+   * @brief The thread reading a socket client's lines. The reader marks itself
+   * done when the client goes, and is joined and forgotten by the accept
+   * loop, which only holds on to the client weakly.
+   *
+   */
+  struct Reader {
+    std::thread thread;
+    std::weak_ptr<Client> client;
+    bool done;
+  };
+
+  struct Job {
+    std::string id;
+    std::string scene;
+    Camera camera;
+    int divisions;
+    int samples;
+    std::string output;
+    std::shared_ptr<Client> client;
+
+    Framebuffer image;
+    std::vector<Tile> tiles;
+    size_t nextTile;
+    size_t tilesLeft;
+    std::chrono::steady_clock::time_point received;
+    std::chrono::steady_clock::time_point started;
+  };
+
+  TileRenderer render;
+  SceneLoader loadScene;
+  Camera baseCamera;
+  int defaultDivisions;
+  int defaultSamples;
+  int threadCount;
+  int tileSize;
+
+  std::mutex stateMutex;
+  std::condition_variable wake;
+  std::deque<std::shared_ptr<Job> > waiting;
+  std::vector<std::shared_ptr<Job> > running;
+  std::string currentScene;
+  bool stopping;
+  size_t jobsDone;
+  std::list<Reader> readers; // Guarded by `stateMutex`
+
+  bool parseJob(const std::string &line, Job *job, std::string *error);
+  bool handleLine(const std::string &line,
+                  const std::shared_ptr<Client> &client);
+  void serveClient(std::shared_ptr<Client> client, Reader *reader);
+  void joinFinishedReaders();
+  void work();
+  void finish(const std::shared_ptr<Job> &job);
+  void stop();
+  bool isStopping();
+  int serveSocket(const char *path);
+
+public:
+  RenderServer(TileRenderer renderer, SceneLoader loader, const Camera &view,
+               int divisions, int samples, int threads, int tiles);
+
+  int serve(const char *path);
+};
+
+#endif //! H_RENDER_SERVER
@@ -0,0 +1,114 @@
+#include "RenderThread.h"
+#include "Timeline.h"
+#include <chrono>
+
+using namespace std;
+
+/**
+ * @brief Starts the render thread, which waits for the first request.
+ *
+ * @param renderer Traces each frame.
+ */
+RenderThread::RenderThread(FrameRenderer renderer)
+    : render(renderer), front(0), hasPending(false), rendering(false),
+      stopping(false), frameReady(false) {
+  worker = thread(&RenderThread::run, this);
+}
+
+/**
+ * @brief Stops the render thread once the frame it is tracing is complete.
+ *
+ */
+RenderThread::~RenderThread() {
+  {
+    lock_guard<mutex> lock(stateMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  worker.join();
+}
+
+/**
+ * @brief Asks for a frame to be traced, replacing any request which has not
+ * been started yet. The scene is moved to `sceneSeconds` on the render thread,
+ * just before the frame is traced, so the caller never waits for a frame.
+ *
+ * @param camera
+ * @param divisions
+ * @param samples
+ * @param sceneSeconds Time in the scene's animation.
+ */
+void RenderThread::request(const Camera &camera, int divisions, int samples,
+                           float sceneSeconds) {
+  {
+    lock_guard<mutex> lock(stateMutex);
+    pending.camera = camera;
+    pending.divisions = divisions;
+    pending.samples = samples;
+    pending.sceneSeconds = sceneSeconds;
+    hasPending = true;
+  }
+  wake.notify_all();
+}
+
+/**
+ * @brief Checks whether a frame has been completed since the last call.
+ *
+ * @param stats Receives how the frame was traced, if one was completed.
+ * @return true A new frame is in the front buffer.
+ * @return false
+ */
+bool RenderThread::takeFrame(FrameStats *stats) {
+  lock_guard<mutex> lock(stateMutex);
+  if (!frameReady) {
+    return false;
+  }
+  frameReady = false;
+  *stats = lastFrame;
+  return true;
+}
+
+/**
+ * @brief Waits until every request has been traced. The scene must not be
+ * changed while the render thread is tracing it.
+ *
+ */
+void RenderThread::waitIdle() {
+  unique_lock<mutex> lock(stateMutex);
+  wake.wait(lock, [this]() { return !hasPending && !rendering; });
+}
+
+/**
+ * @brief The render thread's loop: traces the latest request into the back
+ * buffer, then swaps it to the front.
+ *
+ */
+void RenderThread::run() {
+  nameTimelineThread("Render thread");
+  unique_lock<mutex> lock(stateMutex);
+  while (true) {
+    wake.wait(lock, [this]() { return hasPending || stopping; });
+    if (stopping) {
+      return;
+    }
+    Request job = pending;
+    hasPending = false;
+    rendering = true;
+    Framebuffer &back = buffers[1 - front];
+    lock.unlock();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    render(job.camera, job.divisions, job.samples, job.sceneSeconds, &back);
+    chrono::duration<float, milli> frameTime =
+        chrono::steady_clock::now() - start;
+
+    lock.lock();
+    front = 1 - front;
+    rendering = false;
+    frameReady = true;
+    lastFrame.frameMs = frameTime.count();
+    lastFrame.divisions = job.divisions;
+    lastFrame.samples = job.samples;
+    wake.notify_all();
+  }
+}
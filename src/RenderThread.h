@@ -0,0 +1,91 @@
+#ifndef H_RENDER_THREAD
+#define H_RENDER_THREAD
+
+#include "Camera.h"
+#include "Framebuffer.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Traces a whole frame from `camera` into `frame`, at `divisions` x
+ * `divisions` cells with `samples` samples per cell, with the scene's
+ * animation at `sceneSeconds`.
+ *
+ */
+typedef void (*FrameRenderer)(const Camera &camera, int divisions, int samples,
+                              float sceneSeconds, Framebuffer *frame);
+
+/**
+ * @brief How a completed frame was traced.
+ *
+ */
+struct FrameStats {
+  float frameMs; // How long the frame took to trace
+  int divisions;
+  int samples;
+};
+
+/**
+ * @brief Traces frames on a thread of its own, so that the window stays
+ * responsive while a frame is traced. Frames are traced into a back buffer,
+ * which is swapped with the front buffer once complete; the window only ever
+ * shows the front buffer.
+ *
+ * Only the most recent request is kept: requests made while a frame is being
+ * traced replace each other, and the latest is traced next.
+ *
+ */
+class RenderThread {
+private:
+  struct Request {
+    Camera camera;
+    int divisions;
+    int samples;
+    float sceneSeconds;
+  };
+
+  FrameRenderer render;
+  std::thread worker;
+  std::mutex stateMutex;
+  std::condition_variable wake;
+
+  Framebuffer buffers[2];
+  int front;
+
+  Request pending;
+  bool hasPending;
+  bool rendering;
+  bool stopping;
+
+  bool frameReady; // A frame was completed since `takeFrame()`
+  FrameStats lastFrame;
+
+  void run();
+
+public:
+  RenderThread(FrameRenderer renderer);
+  ~RenderThread();
+
+  RenderThread(const RenderThread &) = delete;
+  RenderThread &operator=(const RenderThread &) = delete;
+
+  void request(const Camera &camera, int divisions, int samples,
+               float sceneSeconds);
+
+  bool takeFrame(FrameStats *stats);
+
+  void waitIdle();
+
+  /**
+   * @brief Calls `present(front)` with the most recently completed frame. The
+   * buffers are not swapped while it runs.
+   *
+   */
+  template <class Present> void withFront(Present present) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    present(buffers[front]);
+  }
+};
+
+#endif //! H_RENDER_THREAD
@@ -0,0 +1,216 @@
+#include "Sampler.h"
+#include <math.h>
+
+// 2^-32, which maps a 32 bit integer to [0, 1)
+const float TO_UNIT = 1.0f / 4294967296.0f;
+
+// The largest float below 1
+const float ONE_MINUS_EPSILON = 0.99999994f;
+
+/**
+ * @brief Mixes the bits of an integer, so that nearby inputs give unrelated
+ * outputs (the "lowbias32" hash by Chris Wellons).
+ *
+ * @param x
+ * @return uint32_t
+ */
+static uint32_t hash(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+/**
+ * @brief Shuffles the integers in [0, n), as in Kensler's "Correlated
+ * Multi-Jittered Sampling". Values outside the range are hashed again until
+ * they fall inside it.
+ *
+ * @param i The index to shuffle.
+ * @param n The number of indices.
+ * @param seed Selects the permutation.
+ * @return uint32_t The shuffled index.
+ */
+static uint32_t permute(uint32_t i, uint32_t n, uint32_t seed) {
+  uint32_t mask = n - 1;
+  mask |= mask >> 1;
+  mask |= mask >> 2;
+  mask |= mask >> 4;
+  mask |= mask >> 8;
+  mask |= mask >> 16;
+  do {
+    i ^= seed;
+    i *= 0xe170893du;
+    i ^= seed >> 16;
+    i ^= (i & mask) >> 4;
+    i ^= seed >> 8;
+    i *= 0x0929eb3fu;
+    i ^= seed >> 23;
+    i ^= (i & mask) >> 1;
+    i *= 1 | seed >> 27;
+    i *= 0x6935fa69u;
+    i ^= (i & mask) >> 11;
+    i *= 0x74dcb303u;
+    i ^= (i & mask) >> 2;
+    i *= 0x9e501cc3u;
+    i ^= (i & mask) >> 2;
+    i *= 0xc860a3dfu;
+    i &= mask;
+    i ^= i >> 5;
+  } while (i >= n);
+  return (i + seed) % n;
+}
+
+/**
+ * @brief The first Sobol dimension, which reverses the bits of the index.
+ *
+ * @param i
+ * @return uint32_t
+ */
+static uint32_t sobol0(uint32_t i) {
+  i = (i << 16) | (i >> 16);
+  i = ((i & 0x00ff00ffu) << 8) | ((i & 0xff00ff00u) >> 8);
+  i = ((i & 0x0f0f0f0fu) << 4) | ((i & 0xf0f0f0f0u) >> 4);
+  i = ((i & 0x33333333u) << 2) | ((i & 0xccccccccu) >> 2);
+  i = ((i & 0x55555555u) << 1) | ((i & 0xaaaaaaaau) >> 1);
+  return i;
+}
+
+/**
+ * @brief The second Sobol dimension.
+ *
+ * @param i
+ * @return uint32_t
+ */
+static uint32_t sobol1(uint32_t i) {
+  uint32_t result = 0;
+  for (uint32_t v = 1u << 31; i != 0; i >>= 1, v ^= v >> 1) {
+    if (i & 1) {
+      result ^= v;
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief The radical inverse of an index in base 3, the second Halton
+ * dimension.
+ *
+ * @param i
+ * @return float
+ */
+static float radicalInverse3(uint32_t i) {
+  double result = 0;
+  double scale = 1.0 / 3;
+  for (; i != 0; i /= 3, scale /= 3) {
+    result += (i % 3) * scale;
+  }
+  return (float)result;
+}
+
+/**
+ * @brief Maps a 32 bit integer to [0, 1).
+ *
+ * @param bits
+ * @return float
+ */
+static float toUnit(uint32_t bits) {
+  return fminf(bits * TO_UNIT, ONE_MINUS_EPSILON);
+}
+
+/**
+ * @brief Adds an offset to a value in [0, 1), wrapping around at 1.
+ *
+ * @param value
+ * @param offset
+ * @return float
+ */
+static float rotate(float value, uint32_t offset) {
+  value += offset * TO_UNIT;
+  if (value >= 1) {
+    value -= 1;
+  }
+  return fminf(value, ONE_MINUS_EPSILON);
+}
+
+/**
+ * @brief Gets one dimension of a sample, as a point in the unit square.
+ *
+ * @param sample The cell and sample.
+ * @param dimension Which decision the point is for.
+ * @return glm::vec2
+ */
+glm::vec2 Sampler::get2D(const PixelSample &sample, int dimension) const {
+  uint32_t seed = hash(sample.seed ^ hash(dimension));
+  uint32_t index = sample.index;
+  if (dimension > 0) {
+    index = permute(index, sample.count, seed);
+  }
+
+  switch (pattern) {
+    case SAMPLES_SOBOL: {
+      // Random digit scrambling keeps the sequence stratified
+      uint32_t scrambleX = hash(seed + 1);
+      uint32_t scrambleY = hash(seed + 2);
+      return glm::vec2(toUnit(sobol0(index) ^ scrambleX),
+                       toUnit(sobol1(index) ^ scrambleY));
+    }
+    case SAMPLES_HALTON:
+      return glm::vec2(rotate(toUnit(sobol0(index)), hash(seed + 1)),
+                       rotate(radicalInverse3(index), hash(seed + 2)));
+    case SAMPLES_GRID:
+      break;
+  }
+
+  // The grid is as square as the number of samples allows
+  int gridHeight = (int)sqrtf((float)sample.count);
+  while (sample.count % gridHeight != 0) {
+    gridHeight--;
+  }
+  int gridWidth = sample.count / gridHeight;
+
+  glm::vec2 u((index % gridWidth + 0.5f) / gridWidth,
+              (index / gridWidth + 0.5f) / gridHeight);
+  if (dimension > 0) {
+    u = glm::vec2(rotate(u.x, hash(seed + 1)), rotate(u.y, hash(seed + 2)));
+  }
+  return u;
+}
+
+/**
+ * @brief Gets the seed of a cell, from its position in the whole image.
+ *
+ * @param x
+ * @param y
+ * @return uint32_t
+ */
+uint32_t Sampler::pixelSeed(int x, int y) {
+  return hash((uint32_t)x ^ hash((uint32_t)y));
+}
+
+/**
+ * @brief Maps a point in the unit square to the unit disk, with Shirley and
+ * Chiu's concentric mapping, which keeps stratified points stratified.
+ *
+ * @param u
+ * @return glm::vec2
+ */
+glm::vec2 Sampler::squareToDisk(glm::vec2 u) {
+  float a = 2 * u.x - 1;
+  float b = 2 * u.y - 1;
+  if (a == 0 && b == 0) {
+    return glm::vec2(0);
+  }
+
+  float r, phi;
+  if (a * a > b * b) {
+    r = a;
+    phi = (M_PI / 4) * (b / a);
+  } else {
+    r = b;
+    phi = M_PI / 2 - (M_PI / 4) * (a / b);
+  }
+  return glm::vec2(r * cosf(phi), r * sinf(phi));
+}
@@ -0,0 +1,60 @@
+#ifndef H_SAMPLER
+#define H_SAMPLER
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+
+/**
+ * @brief How the samples of a cell are spread over the unit square.
+ *
+ * `SAMPLES_GRID` places them at the centres of a regular grid of strata, the
+ * same for every cell. `SAMPLES_SOBOL` takes them from the (0, 2) sequence
+ * formed by the first two Sobol dimensions, so every power of two prefix is
+ * stratified in both x and y. `SAMPLES_HALTON` takes them from the Halton
+ * sequence in bases 2 and 3.
+ */
+enum SamplePattern { SAMPLES_GRID, SAMPLES_SOBOL, SAMPLES_HALTON };
+
+/**
+ * @brief Identifies one sample of one cell. Every random decision made while
+ * tracing the sample is drawn from it, so the image does not depend on which
+ * thread, tile or worker traced the cell.
+ *
+ */
+struct PixelSample {
+  uint32_t seed; // From `Sampler::pixelSeed`
+  int index;     // Which of the cell's samples this is
+  int count;     // The number of samples in the cell
+};
+
+/**
+ * @brief Produces the sample points used for anti-aliasing and every other
+ * decision made per sample, such as where on an area light a shadow ray is
+ * aimed.
+ *
+ * Each decision uses its own 2D dimension of the sampler. The points of a
+ * dimension are scrambled by a hash of the cell and the dimension, and their
+ * order is shuffled per dimension, so different dimensions and neighbouring
+ * cells are not correlated while each dimension stays stratified. Dimension 0
+ * of `SAMPLES_GRID` is left unscrambled, as it was before the sampler existed.
+ *
+ * The sampler holds no state between samples, so any sample can be generated
+ * on its own.
+ */
+class Sampler {
+private:
+  SamplePattern pattern;
+
+public:
+  Sampler() : pattern(SAMPLES_GRID) {}
+
+  void setPattern(SamplePattern samplePattern) { pattern = samplePattern; }
+
+  glm::vec2 get2D(const PixelSample &sample, int dimension) const;
+
+  static uint32_t pixelSeed(int x, int y);
+
+  static glm::vec2 squareToDisk(glm::vec2 u);
+};
+
+#endif //! H_SAMPLER
@@ -0,0 +1,130 @@
+#include "SceneArena.h"
+#include <cxxabi.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+SceneArena::~SceneArena() {
+  clear();
+  if (!blocks.empty()) {
+    free(blocks[0].data);
+  }
+}
+
+/**
+ * @brief Reserves `size` bytes at the next suitably aligned position of the
+ * current block, starting a new block if it is full.
+ *
+ * @param size
+ * @param alignment
+ * @return void*
+ */
+void *SceneArena::allocate(size_t size, size_t alignment) {
+  if (!blocks.empty()) {
+    Block &block = blocks.back();
+    size_t start = (block.used + alignment - 1) & ~(alignment - 1);
+    if (start + size <= block.size) {
+      block.used = start + size;
+      return block.data + start;
+    }
+  }
+
+  // Objects larger than a block get a block of their own
+  Block block;
+  block.size = size > blockSize ? size : blockSize;
+  block.data = (char *)malloc(block.size);
+  if (block.data == NULL) {
+    throw bad_alloc();
+  }
+  block.used = size;
+  blocks.push_back(block);
+  return block.data;
+}
+
+/**
+ * @brief Adds an object to the memory use of its type.
+ *
+ * @param type The mangled name of the object's type.
+ * @param size The size of the object, in bytes.
+ */
+void SceneArena::record(const char *type, size_t size) {
+  for (size_t i = 0; i < usage.size(); i++) {
+    if (strcmp(usage[i].type, type) == 0) {
+      usage[i].count++;
+      usage[i].bytes += size;
+      return;
+    }
+  }
+  TypeUsage entry = {type, 1, size};
+  usage.push_back(entry);
+}
+
+/**
+ * @brief Destroys every object in the arena, in the reverse order they were
+ * created. The first block is kept for the next scene, and the rest are
+ * released.
+ *
+ */
+void SceneArena::clear() {
+  for (size_t i = allocations.size(); i > 0; i--) {
+    allocations[i - 1].destroy(allocations[i - 1].object);
+  }
+  allocations.clear();
+  usage.clear();
+
+  for (size_t i = 1; i < blocks.size(); i++) {
+    free(blocks[i].data);
+  }
+  if (!blocks.empty()) {
+    blocks.resize(1);
+    blocks[0].used = 0;
+  }
+}
+
+/**
+ * @brief Returns the number of bytes taken up by objects, including padding
+ * for alignment.
+ *
+ * @return size_t
+ */
+size_t SceneArena::bytesUsed() const {
+  size_t used = 0;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    used += blocks[i].used;
+  }
+  return used;
+}
+
+/**
+ * @brief Returns the number of bytes the arena has reserved from the heap.
+ *
+ * @return size_t
+ */
+size_t SceneArena::bytesReserved() const {
+  size_t reserved = 0;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    reserved += blocks[i].size;
+  }
+  return reserved;
+}
+
+/**
+ * @brief Prints the number of objects and bytes used by each type of object,
+ * followed by the arena's totals.
+ *
+ * @param out
+ */
+void SceneArena::report(ostream &out) const {
+  for (size_t i = 0; i < usage.size(); i++) {
+    int status;
+    char *name = abi::__cxa_demangle(usage[i].type, NULL, NULL, &status);
+    out << "  " << (status == 0 ? name : usage[i].type) << ": "
+        << usage[i].count << " objects, " << usage[i].bytes << " bytes\n";
+    free(name);
+  }
+  out << "  Total: " << allocations.size() << " objects, " << bytesUsed()
+      << " bytes used of " << bytesReserved() << " bytes in " << blocks.size()
+      << " blocks" << endl;
+}
@@ -0,0 +1,80 @@
+#ifndef H_SCENE_ARENA
+#define H_SCENE_ARENA
+
+#include <ostream>
+#include <stddef.h>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Owns the objects of a scene. Objects are placed one after another in
+ * large blocks of memory, in the order they are created, so objects that are
+ * traversed together sit together in memory. All objects are destroyed at
+ * once by `clear()`, which keeps the first block so that reloading a scene
+ * reuses the same memory.
+ *
+ */
+class SceneArena {
+private:
+  struct Block {
+    char *data;
+    size_t size;
+    size_t used;
+  };
+
+  struct Allocation {
+    void *object;
+    void (*destroy)(void *);
+  };
+
+  struct TypeUsage {
+    const char *type;
+    size_t count;
+    size_t bytes;
+  };
+
+  size_t blockSize;
+  std::vector<Block> blocks;
+  std::vector<Allocation> allocations;
+  std::vector<TypeUsage> usage;
+
+  void *allocate(size_t size, size_t alignment);
+  void record(const char *type, size_t size);
+
+  template <class T> static void destroy(void *object) {
+    static_cast<T *>(object)->~T();
+  }
+
+public:
+  SceneArena(size_t size = 4096) : blockSize(size) {}
+  ~SceneArena();
+
+  SceneArena(const SceneArena &) = delete;
+  SceneArena &operator=(const SceneArena &) = delete;
+
+  /**
+   * @brief Constructs a `T` in the arena. The object lives until the arena is
+   * cleared or destroyed, and must not be deleted directly.
+   *
+   * @return T* The new object.
+   */
+  template <class T, class... Args> T *create(Args &&... args) {
+    void *memory = allocate(sizeof(T), alignof(T));
+    T *object = new (memory) T(std::forward<Args>(args)...);
+    Allocation allocation = {object, &SceneArena::destroy<T>};
+    allocations.push_back(allocation);
+    record(typeid(T).name(), sizeof(T));
+    return object;
+  }
+
+  void clear();
+
+  size_t bytesUsed() const;
+
+  size_t bytesReserved() const;
+
+  void report(std::ostream &out) const;
+};
+
+#endif //! H_SCENE_ARENA
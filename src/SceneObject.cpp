@@ -18,3 +18,9 @@ void SceneObject::setColor(glm::vec3 col)
 {
 	color = col;
 }
+
+void SceneObject::setPattern(Pattern p, TextureBMP *tex)
+{
+	pattern = p;
+	texture = tex;
+}
@@ -12,19 +12,61 @@
 #ifndef H_SOBJECT
 #define H_SOBJECT
 #include <glm/glm.hpp>
+#include "AABB.h"
 
+class TextureBMP;
+
+// How the colour of an object varies over its surface
+enum Pattern
+{
+	PATTERN_NONE,		//A single colour
+	PATTERN_TEXTURE,	//A texture wrapped around a sphere
+	PATTERN_CHECKERS,	//Large checkers, for the floor
+	PATTERN_STRIPES		//Diagonal stripes
+};
 
 class SceneObject
 {
 protected:
 	glm::vec3 color;
+	float reflectivity;		//0 if the object is not reflective
+	bool refractive;
+	bool transparent;
+	Pattern pattern;
+	TextureBMP *texture;	//Only used by PATTERN_TEXTURE
 public:
-	SceneObject() {}
+	SceneObject()
+		: reflectivity(0), refractive(false), transparent(false),
+		  pattern(PATTERN_NONE), texture(NULL) {}
     virtual float intersect(glm::vec3 pos, glm::vec3 dir) = 0;
 	virtual glm::vec3 normal(glm::vec3 pos) = 0;
+	virtual AABB bounds() = 0;
+
+	// Objects made of several parts (such as instances) report which part was
+	// hit, so that its normal can be found later. Simple objects have one part.
+	virtual float intersectPart(glm::vec3 pos, glm::vec3 dir, int *part)
+	{
+		*part = 0;
+		return intersect(pos, dir);
+	}
+	virtual glm::vec3 normalOfPart(glm::vec3 pos, int part)
+	{
+		return normal(pos);
+	}
+
 	virtual ~SceneObject() {}
 	glm::vec3 getColor();
 	void setColor(glm::vec3 col);
+
+	float getReflectivity() const { return reflectivity; }
+	void setReflectivity(float r) { reflectivity = r; }
+	bool isRefractive() const { return refractive; }
+	void setRefractive(bool r) { refractive = r; }
+	bool isTransparent() const { return transparent; }
+	void setTransparent(bool t) { transparent = t; }
+	Pattern getPattern() const { return pattern; }
+	TextureBMP *getTexture() const { return texture; }
+	void setPattern(Pattern p, TextureBMP *tex = NULL);
 };
 
 #endif
@@ -0,0 +1,92 @@
+#ifndef H_SHADOW_CACHE
+#define H_SHADOW_CACHE
+
+#include "Lighting.h"
+#include <ostream>
+#include <stddef.h>
+
+/**
+ * @brief Remembers, for each light, the object which last blocked a shadow
+ * ray. Neighbouring points are usually shadowed by the same object, so it is
+ * tested before searching the whole scene. Each thread keeps its own cache.
+ *
+ * The cache is tied to a scene generation, and forgets its occluders when a
+ * different scene is loaded, since object indices change.
+ *
+ */
+class ShadowCache {
+private:
+  unsigned generation;
+  int occluders[NUM_LIGHTS];
+  size_t hits[NUM_LIGHTS];
+  size_t misses[NUM_LIGHTS];
+  size_t unblocked[NUM_LIGHTS];
+
+public:
+  ShadowCache() : generation(0) {
+    for (int light = 0; light < NUM_LIGHTS; light++) {
+      occluders[light] = -1;
+      hits[light] = 0;
+      misses[light] = 0;
+      unblocked[light] = 0;
+    }
+  }
+
+  /**
+   * @brief Forgets the occluders if they belong to another scene.
+   *
+   * @param sceneGeneration The generation of the current scene.
+   */
+  void useScene(unsigned sceneGeneration) {
+    if (generation != sceneGeneration) {
+      generation = sceneGeneration;
+      for (int light = 0; light < NUM_LIGHTS; light++) {
+        occluders[light] = -1;
+      }
+    }
+  }
+
+  // The index of the object which last blocked `light`, or -1
+  int occluder(int light) const { return occluders[light]; }
+
+  // Records that the cached occluder blocked a shadow ray
+  void hit(int light) { hits[light]++; }
+
+  // Records that the cached occluder did not block a shadow ray, and which
+  // object did, if any
+  void miss(int light, int occluder) {
+    if (occluder == -1) {
+      unblocked[light]++;
+    } else {
+      misses[light]++;
+      occluders[light] = occluder;
+    }
+  }
+
+  void clearStats() {
+    for (int light = 0; light < NUM_LIGHTS; light++) {
+      hits[light] = 0;
+      misses[light] = 0;
+      unblocked[light] = 0;
+    }
+  }
+
+  /**
+   * @brief Prints how many blocked shadow rays of each light were blocked by
+   * the cached occluder (hits) or by another object (misses).
+   *
+   */
+  void report(std::ostream &out) const {
+    for (int light = 0; light < NUM_LIGHTS; light++) {
+      size_t total = hits[light] + misses[light];
+      out << "  Light " << light << ": " << hits[light] << " hits, "
+          << misses[light] << " misses";
+      if (total > 0) {
+        out << " (" << 100.0 * hits[light] / total << "% hit)";
+      }
+      out << ", " << unblocked[light] << " rays unblocked\n";
+    }
+  }
+};
+
+#endif //! H_SHADOW_CACHE
@@ -0,0 +1,178 @@
+#include "SharedFramebuffer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Where the pixels start, leaving room for the header to grow
+const uint32_t DATA_OFFSET = 256;
+
+static_assert(sizeof(SharedFrameHeader) <= DATA_OFFSET,
+              "The shared header must fit before the pixels");
+
+/**
+ * @brief Unmaps the shared memory. The object itself is left in place with the
+ * last frame, so that it can still be read after the renderer has exited,
+ * until the next renderer publishing under the same name replaces it.
+ *
+ */
+SharedFramebuffer::~SharedFramebuffer() {
+  if (header != NULL) {
+    munmap(header, mappedBytes);
+  }
+}
+
+/**
+ * @brief Creates the shared memory object, replacing any left by an earlier
+ * run, and maps it.
+ *
+ * @param sharedName The name of the object, such as "/raytracer", which
+ * appears as /dev/shm/raytracer on Linux.
+ * @param capacityWidth The widest frame that will be published.
+ * @param capacityHeight The tallest frame that will be published.
+ * @return true The framebuffer is ready.
+ * @return false The shared memory could not be created.
+ */
+bool SharedFramebuffer::open(const char *sharedName, int capacityWidth,
+                             int capacityHeight) {
+  shm_unlink(sharedName);
+  int fd = shm_open(sharedName, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    cerr << "Could not create shared memory " << sharedName << ": "
+         << strerror(errno) << endl;
+    return false;
+  }
+
+  size_t bytes = DATA_OFFSET + (size_t)capacityWidth * capacityHeight * 3;
+  void *mapped = MAP_FAILED;
+  if (ftruncate(fd, bytes) == 0) {
+    mapped = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    cerr << "Could not map shared memory " << sharedName << ": "
+         << strerror(errno) << endl;
+    shm_unlink(sharedName);
+    return false;
+  }
+
+  // The object is zero filled, so the counters start at zero, and the magic
+  // number is written last so readers only trust a complete header
+  mappedBytes = bytes;
+  header = new (mapped) SharedFrameHeader;
+  data = (unsigned char *)mapped + DATA_OFFSET;
+  header->version = SHARED_FRAME_VERSION;
+  header->format = SHARED_RGB8;
+  header->dataOffset = DATA_OFFSET;
+  header->capacityWidth = capacityWidth;
+  header->capacityHeight = capacityHeight;
+  header->width.store(0, memory_order_relaxed);
+  header->height.store(0, memory_order_relaxed);
+  header->sequence.store(0, memory_order_relaxed);
+  header->frames.store(0, memory_order_relaxed);
+  header->tiles.store(0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  header->magic = SHARED_FRAME_MAGIC;
+  return true;
+}
+
+/**
+ * @brief Makes the sequence odd, so readers know a write is under way.
+ *
+ */
+void SharedFramebuffer::beginWrite() {
+  header->sequence.fetch_add(1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * @brief Makes the sequence even again, publishing the write.
+ *
+ */
+void SharedFramebuffer::endWrite() {
+  header->sequence.fetch_add(1, memory_order_release);
+}
+
+/**
+ * @brief Starts a frame of the given size, which must be within the capacity.
+ * The pixels of the last frame stay in place until tiles replace them.
+ *
+ * @param width
+ * @param height
+ */
+void SharedFramebuffer::beginFrame(int width, int height) {
+  beginWrite();
+  header->width.store(width, memory_order_relaxed);
+  header->height.store(height, memory_order_relaxed);
+  endWrite();
+}
+
+/**
+ * @brief Writes a traced tile of the current frame into the shared pixels.
+ * Tiles may be written from several threads, as long as only one writes at a
+ * time.
+ *
+ * @param tile
+ * @param tilePixels Row by row from the bottom row of the tile.
+ */
+void SharedFramebuffer::setTile(const Tile &tile,
+                                const glm::vec3 *tilePixels) {
+  int width = header->width.load(memory_order_relaxed);
+  int height = header->height.load(memory_order_relaxed);
+  beginWrite();
+  for (int j = 0; j < tile.height; j++) {
+    unsigned char *row =
+        data + ((size_t)(height - 1 - tile.y - j) * width + tile.x) * 3;
+    const glm::vec3 *source = &tilePixels[j * tile.width];
+    for (int i = 0; i < tile.width; i++) {
+      row[i * 3] = toByte(source[i].r);
+      row[i * 3 + 1] = toByte(source[i].g);
+      row[i * 3 + 2] = toByte(source[i].b);
+    }
+  }
+  header->tiles.fetch_add(1, memory_order_relaxed);
+  endWrite();
+
+  if (next != NULL) {
+    next->setTile(tile, tilePixels);
+  }
+}
+
+/**
+ * @brief Marks the current frame as complete.
+ *
+ */
+void SharedFramebuffer::endFrame() {
+  beginWrite();
+  header->frames.fetch_add(1, memory_order_relaxed);
+  endWrite();
+}
+
+/**
+ * @brief Publishes a whole frame in one write.
+ *
+ * @param frame
+ */
+void SharedFramebuffer::publish(const Framebuffer &frame) {
+  int width = min(frame.width, (int)header->capacityWidth);
+  int height = min(frame.height, (int)header->capacityHeight);
+  beginWrite();
+  header->width.store(width, memory_order_relaxed);
+  header->height.store(height, memory_order_relaxed);
+  for (int y = 0; y < height; y++) {
+    unsigned char *row = data + (size_t)(height - 1 - y) * width * 3;
+    for (int x = 0; x < width; x++) {
+      const glm::vec3 &col = frame.at(x, y);
+      row[x * 3] = toByte(col.r);
+      row[x * 3 + 1] = toByte(col.g);
+      row[x * 3 + 2] = toByte(col.b);
+    }
+  }
+  header->frames.fetch_add(1, memory_order_relaxed);
+  endWrite();
+}
@@ -0,0 +1,90 @@
+#ifndef H_SHARED_FRAMEBUFFER
+#define H_SHARED_FRAMEBUFFER
+
+#include "Framebuffer.h"
+#include "TileSink.h"
+#include <atomic>
+#include <stdint.h>
+
+// "RTFB", the first bytes of a shared framebuffer
+const uint32_t SHARED_FRAME_MAGIC = 0x42465452;
+
+const uint32_t SHARED_FRAME_VERSION = 1;
+
+/**
+ * @brief How the pixels of a shared framebuffer are stored. `SHARED_RGB8` is
+ * three bytes per pixel, red first, with the top row first, as in a PPM image.
+ *
+ */
+enum SharedPixelFormat { SHARED_RGB8 = 1 };
+
+/**
+ * @brief The start of a shared framebuffer, followed at `dataOffset` by
+ * `capacityWidth * capacityHeight` pixels.
+ *
+ * `sequence` is a seqlock: it is odd while the renderer is writing, and is
+ * increased again once it has finished. A reader copies what it needs between
+ * two loads of `sequence`, and keeps the copy only if both loads gave the same
+ * even value. Every other field except the capacity may change during a write,
+ * so `width` and `height`, the size of the current frame, are read inside the
+ * seqlock too. `frames` counts the frames completed, and `tiles` the tiles
+ * written, so a reader polling them can tell whether anything has changed.
+ */
+struct SharedFrameHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t format;
+  uint32_t dataOffset;
+  uint32_t capacityWidth;
+  uint32_t capacityHeight;
+  std::atomic<uint32_t> width;
+  std::atomic<uint32_t> height;
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint64_t> frames;
+  std::atomic<uint64_t> tiles;
+};
+
+/**
+ * @brief Publishes images through POSIX shared memory, so that other processes
+ * can map them and read updates as they happen, without copies or encoding.
+ *
+ * Tiles are written into the shared pixels as they are traced, and whole
+ * frames as they are completed. Every update is bracketed by the seqlock in
+ * the header, and the writer never waits for readers. As a sink, the
+ * framebuffer may pass tiles on to another sink, so that an image is
+ * published and also written out.
+ */
+class SharedFramebuffer : public TileSink {
+private:
+  SharedFrameHeader *header;
+  unsigned char *data;
+  size_t mappedBytes;
+  TileSink *next;
+
+  void beginWrite();
+  void endWrite();
+
+public:
+  SharedFramebuffer() : header(NULL), data(NULL), mappedBytes(0), next(NULL) {}
+  ~SharedFramebuffer();
+
+  bool open(const char *sharedName, int capacityWidth, int capacityHeight);
+
+  bool isOpen() const { return header != NULL; }
+
+  /**
+   * @brief Passes every tile on to `sink` too, once it has been published.
+   *
+   */
+  void forwardTo(TileSink *sink) { next = sink; }
+
+  void beginFrame(int width, int height);
+
+  void setTile(const Tile &tile, const glm::vec3 *tilePixels);
+
+  void endFrame();
+
+  void publish(const Framebuffer &frame);
+};
+
+#endif //! H_SHARED_FRAMEBUFFER
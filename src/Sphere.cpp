@@ -45,3 +45,11 @@ glm::vec3 Sphere::normal(glm::vec3 p)
     n = glm::normalize(n);
     return n;
 }
+
+/**
+* Returns the box enclosing the sphere.
+*/
+AABB Sphere::bounds()
+{
+    return AABB(center - glm::vec3(radius), center + glm::vec3(radius));
+}
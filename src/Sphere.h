@@ -39,6 +39,8 @@ public:
 
 	glm::vec3 normal(glm::vec3 p);
 
+	AABB bounds();
+
 };
 
 #endif //!H_SPHERE
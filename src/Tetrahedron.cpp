@@ -1,4 +1,5 @@
 #include "Tetrahedron.h"
+#include "ConvexPolyhedron.h"
 #include "Triangle.h"
 
 using namespace std;
@@ -29,31 +30,48 @@ using namespace std;
 /**
  * @brief Draws a tetrahedron, with the center being at (x, y, z), with the
  * given width, length, height, and color. The tetrahedron is pushed onto the
- * given scene objects vector.
+ * given scene objects vector, either as one `ConvexPolyhedron` or as four
+ * `Triangle` faces.
  *
  * @param x x-coordinate of the center of the tetrahedron.
  * @param y y-coordinate of the center of the tetrahedron.
  * @param z z-coordinate of the center of the tetrahedron.
  * @param color The color of the tetrahedron to draw.
+ * @param arena The arena the faces are created in.
  * @param sceneObjects The vector of scene objects the tetrahedron should be
  * pushed onto.
+ * @param solid Whether the tetrahedron is a single `ConvexPolyhedron`, which
+ * is intersected in one pass, rather than four faces tested separately.
  */
 void drawTetrahedron(float x, float y, float z, glm::vec3 color,
-                     vector<SceneObject *> *sceneObjects) {
+                     SceneArena *arena, vector<SceneObject *> *sceneObjects,
+                     bool solid) {
   glm::vec3 A = glm::vec3(x - 3, y, z);
   glm::vec3 B = glm::vec3(x + 3, y, z);
   glm::vec3 C = glm::vec3(x, y, z + 6);
   glm::vec3 D = glm::vec3(x, y + 6, z + 3);
 
-  Triangle *front = new Triangle(B, A, D, color);
+  if (solid) {
+    // The faces are in the same order as the triangles below, which all face
+    // outwards
+    ConvexPolyhedron *tetrahedron = arena->create<ConvexPolyhedron>(color);
+    tetrahedron->addFace(B, A, D);
+    tetrahedron->addFace(A, C, D);
+    tetrahedron->addFace(C, B, D);
+    tetrahedron->addFace(A, B, C);
+    sceneObjects->push_back(tetrahedron);
+    return;
+  }
+
+  Triangle *front = arena->create<Triangle>(B, A, D, color);
   sceneObjects->push_back(front);
 
-  Triangle *left = new Triangle(A, C, D, color);
+  Triangle *left = arena->create<Triangle>(A, C, D, color);
   sceneObjects->push_back(left);
 
-  Triangle *right = new Triangle(C, B, D, color);
+  Triangle *right = arena->create<Triangle>(C, B, D, color);
   sceneObjects->push_back(right);
 
-  Triangle *bottom = new Triangle(A, B, C, color);
+  Triangle *bottom = arena->create<Triangle>(A, B, C, color);
   sceneObjects->push_back(bottom);
 }
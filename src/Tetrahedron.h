@@ -1,3 +1,4 @@
+#include "SceneArena.h"
 #include "SceneObject.h"
 #include <glm/glm.hpp>
 #include <vector>
@@ -5,4 +6,5 @@
 using namespace std;
 
 void drawTetrahedron(float x, float y, float z, glm::vec3 color,
-                     vector<SceneObject *> *sceneObjects);
+                     SceneArena *arena, vector<SceneObject *> *sceneObjects,
+                     bool solid = true);
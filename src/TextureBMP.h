@@ -13,13 +13,14 @@
 #include <iostream>
 #include <fstream>
 #include <glm/glm.hpp>
+#include <vector>
 using namespace std;
 
 class TextureBMP
 {
     private:
         int imageWid, imageHgt, imageChnls;  //Width, height, number of channels
-        char* imageData;
+        vector<char> imageData;  //Owned, so reassigning frees the old image
         bool loadBMPImage(char* string);
     public:
 		TextureBMP(): imageWid(0), imageHgt(0), imageChnls(0) {}
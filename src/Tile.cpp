@@ -0,0 +1,139 @@
+#include "Tile.h"
+#include <algorithm>
+#include <string.h>
+
+// The names of the orders, as given on the command line
+static const char *const ORDER_NAMES[] = {"scanline", "tiled", "morton",
+                                          "hilbert"};
+
+/**
+ * @brief Interleaves the bits of x and y, giving the position of (x, y) along
+ * a Z-order curve.
+ *
+ * @param x
+ * @param y
+ * @return unsigned
+ */
+static unsigned mortonIndex(unsigned x, unsigned y) {
+  unsigned index = 0;
+  for (int bit = 0; bit < 16; bit++) {
+    index |= ((x >> bit) & 1) << (2 * bit);
+    index |= ((y >> bit) & 1) << (2 * bit + 1);
+  }
+  return index;
+}
+
+/**
+ * @brief Finds the position of (x, y) along a Hilbert curve filling an n by n
+ * grid, where n is a power of two.
+ *
+ * @param n
+ * @param x
+ * @param y
+ * @return unsigned
+ */
+static unsigned hilbertIndex(unsigned n, unsigned x, unsigned y) {
+  unsigned index = 0;
+  for (unsigned s = n / 2; s > 0; s /= 2) {
+    unsigned rx = (x & s) > 0;
+    unsigned ry = (y & s) > 0;
+    index += s * s * ((3 * rx) ^ ry);
+
+    // Rotate the quadrant so the curve inside it starts and ends in the
+    // right corners
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s - 1 - x;
+        y = s - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return index;
+}
+
+/**
+ * @brief Splits an image into tiles, in the given order. Square tiles along
+ * the top and right edges are clipped to the image.
+ *
+ * @param width Width of the image, in cells.
+ * @param height Height of the image, in cells.
+ * @param tileSize The width and height of each square tile, in cells.
+ * @param order The order the tiles are traced in.
+ * @param topDown Whether the order starts from the top of the image, the order
+ * a PPM image is written in, rather than from the bottom.
+ * @return std::vector<Tile>
+ */
+std::vector<Tile> splitIntoTiles(int width, int height, int tileSize,
+                                 TileOrder order, bool topDown) {
+  std::vector<Tile> tiles;
+  if (order == ORDER_SCANLINE) {
+    for (int row = 0; row < height; row++) {
+      Tile tile = {0, topDown ? height - 1 - row : row, width, 1};
+      tiles.push_back(tile);
+    }
+    return tiles;
+  }
+
+  int columns = (width + tileSize - 1) / tileSize;
+  int rows = (height + tileSize - 1) / tileSize;
+  unsigned gridSize = 1;
+  while (gridSize < (unsigned)std::max(columns, rows)) {
+    gridSize *= 2;
+  }
+
+  std::vector<std::pair<unsigned, int> > keys;
+  for (int row = 0; row < rows; row++) {
+    int y = (topDown ? rows - 1 - row : row) * tileSize;
+    for (int column = 0; column < columns; column++) {
+      int x = column * tileSize;
+      Tile tile;
+      tile.x = x;
+      tile.y = y;
+      tile.width = x + tileSize > width ? width - x : tileSize;
+      tile.height = y + tileSize > height ? height - y : tileSize;
+
+      unsigned key = tiles.size();
+      if (order == ORDER_MORTON) {
+        key = mortonIndex(column, row);
+      } else if (order == ORDER_HILBERT) {
+        key = hilbertIndex(gridSize, column, row);
+      }
+      keys.push_back(std::make_pair(key, (int)tiles.size()));
+      tiles.push_back(tile);
+    }
+  }
+
+  std::sort(keys.begin(), keys.end());
+  std::vector<Tile> ordered;
+  for (size_t i = 0; i < keys.size(); i++) {
+    ordered.push_back(tiles[keys[i].second]);
+  }
+  return ordered;
+}
+
+/**
+ * @brief Gets the name of an order, as given on the command line.
+ *
+ * @param order
+ * @return const char*
+ */
+const char *tileOrderName(TileOrder order) { return ORDER_NAMES[order]; }
+
+/**
+ * @brief Parses the name of an order.
+ *
+ * @param name
+ * @param order Receives the order.
+ * @return true The name is known.
+ * @return false The name is not known.
+ */
+bool parseTileOrder(const char *name, TileOrder *order) {
+  for (int i = ORDER_SCANLINE; i <= ORDER_HILBERT; i++) {
+    if (strcmp(name, ORDER_NAMES[i]) == 0) {
+      *order = (TileOrder)i;
+      return true;
+    }
+  }
+  return false;
+}
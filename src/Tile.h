@@ -0,0 +1,37 @@
+#ifndef H_TILE
+#define H_TILE
+
+#include <vector>
+
+/**
+ * @brief A rectangular block of cells in the image. `x` and `y` are the cell
+ * coordinates of the bottom-left corner of the tile, where `y` increases
+ * upwards like the image plane.
+ *
+ */
+struct Tile {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+/**
+ * @brief The order the cells of an image are traced in.
+ *
+ * `ORDER_SCANLINE` traces whole rows of cells, one after another.
+ * `ORDER_TILED` traces square tiles a row of tiles at a time. `ORDER_MORTON`
+ * and `ORDER_HILBERT` trace square tiles along a Z-order or Hilbert curve,
+ * which keep consecutive tiles close together in both directions.
+ */
+enum TileOrder { ORDER_SCANLINE, ORDER_TILED, ORDER_MORTON, ORDER_HILBERT };
+
+std::vector<Tile> splitIntoTiles(int width, int height, int tileSize,
+                                 TileOrder order = ORDER_TILED,
+                                 bool topDown = false);
+
+const char *tileOrderName(TileOrder order);
+
+bool parseTileOrder(const char *name, TileOrder *order);
+
+#endif //! H_TILE
@@ -0,0 +1,213 @@
+#include "TilePool.h"
+#include "Timeline.h"
+#include <atomic>
+#include <dirent.h>
+#include <fstream>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+/**
+ * @brief Parses a Linux CPU list, such as "0-3,8,10-11".
+ *
+ * @param list
+ * @return vector<int>
+ */
+static vector<int> parseCpuList(const string &list) {
+  vector<int> cpus;
+  const char *p = list.c_str();
+  while (*p >= '0' && *p <= '9') {
+    char *end;
+    int first = (int)strtol(p, &end, 10);
+    int last = first;
+    if (*end == '-') {
+      last = (int)strtol(end + 1, &end, 10);
+    }
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+    p = *end == ',' ? end + 1 : end;
+  }
+  return cpus;
+}
+
+/**
+ * @brief Creates a pool of `threads` threads, counting the calling thread.
+ *
+ * @param threads
+ * @param pinThreads Whether each thread is bound to one CPU.
+ */
+TilePool::TilePool(int threads, bool pinThreads)
+    : threadCount(threads), pin(pinThreads) {
+  findNodes();
+}
+
+/**
+ * @brief Finds the NUMA nodes, and which of their CPUs this process may run
+ * on. Without NUMA information, all the CPUs form one node.
+ *
+ */
+void TilePool::findNodes() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    CPU_SET(0, &allowed);
+  }
+
+  DIR *dir = opendir("/sys/devices/system/node");
+  struct dirent *entry;
+  while (dir != NULL && (entry = readdir(dir)) != NULL) {
+    int id;
+    if (sscanf(entry->d_name, "node%d", &id) != 1) {
+      continue;
+    }
+    ifstream file(string("/sys/devices/system/node/") + entry->d_name +
+                  "/cpulist");
+    string list;
+    getline(file, list);
+
+    Node node;
+    node.id = id;
+    vector<int> cpus = parseCpuList(list);
+    for (size_t c = 0; c < cpus.size(); c++) {
+      if (cpus[c] < CPU_SETSIZE && CPU_ISSET(cpus[c], &allowed)) {
+        node.cpus.push_back(cpus[c]);
+      }
+    }
+    if (!node.cpus.empty()) {
+      nodes.push_back(node);
+    }
+  }
+  if (dir != NULL) {
+    closedir(dir);
+  }
+
+  if (nodes.empty()) {
+    Node node;
+    node.id = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        node.cpus.push_back(cpu);
+      }
+    }
+    nodes.push_back(node);
+  }
+}
+
+/**
+ * @brief Traces every tile and passes it to `sink`. Returns once all the
+ * threads have finished.
+ *
+ * Thread t runs on node t % nodes, on the node's CPUs in turn, and the tiles
+ * are split between the nodes in proportion to their threads. Anything
+ * `render` needs to build before tracing, such as the primary visibility
+ * lists, must be built before calling, as the threads share it.
+ *
+ * @param camera
+ * @param divisions
+ * @param samples
+ * @param tiles The tiles, in the order they should be traced.
+ * @param render Traces one tile.
+ * @param sink Receives the traced tiles.
+ */
+void TilePool::render(const Camera &camera, int divisions, int samples,
+                      const vector<Tile> &tiles, TileRenderer render,
+                      TileSink *sink) {
+  int nodeCount = (int)nodes.size();
+  vector<int> threadsOnNode(nodeCount, 0);
+  for (int t = 0; t < threadCount; t++) {
+    threadsOnNode[t % nodeCount]++;
+  }
+
+  // Node n traces tiles [begin[n], begin[n + 1]), taking them in order with
+  // next[n]
+  vector<size_t> begin(nodeCount + 1, 0);
+  for (int n = 0; n < nodeCount; n++) {
+    begin[n + 1] = begin[n] + tiles.size() * threadsOnNode[n] / threadCount;
+  }
+  begin[nodeCount] = tiles.size();
+  vector<atomic<size_t> > next(nodeCount);
+  for (int n = 0; n < nodeCount; n++) {
+    next[n] = begin[n];
+  }
+
+  mutex sinkMutex;
+  tilesPerThread.assign(threadCount, 0);
+
+  auto work = [&](int t) {
+    if (t > 0) {
+      string name = "Tile thread " + to_string(t);
+      nameTimelineThread(name.c_str());
+    }
+    int home = t % nodeCount;
+    if (pin) {
+      const vector<int> &cpus = nodes[home].cpus;
+      cpu_set_t cpu;
+      CPU_ZERO(&cpu);
+      CPU_SET(cpus[t / nodeCount % cpus.size()], &cpu);
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu), &cpu);
+    }
+
+    // Allocated after pinning, so the pages are on this thread's node
+    size_t largestTile = 0;
+    for (size_t i = 0; i < tiles.size(); i++) {
+      largestTile = max(largestTile, (size_t)tiles[i].width * tiles[i].height);
+    }
+    vector<glm::vec3> pixels(largestTile);
+
+    // Take tiles from the home node first, then help the others
+    for (int n = 0; n < nodeCount; n++) {
+      int node = (home + n) % nodeCount;
+      for (size_t i = next[node]++; i < begin[node + 1]; i = next[node]++) {
+        render(camera, tiles[i], divisions, samples, pixels.data());
+        tilesPerThread[t]++;
+        TimelineZone zone("Hand over tile");
+        lock_guard<mutex> lock(sinkMutex);
+        sink->setTile(tiles[i], pixels.data());
+      }
+    }
+  };
+
+  // Thread 0 is the calling thread. Its own CPUs are put back afterwards, as
+  // threads it starts later inherit them
+  cpu_set_t callerCpus;
+  bool restoreCaller =
+      pin && pthread_getaffinity_np(pthread_self(), sizeof(callerCpus),
+                                    &callerCpus) == 0;
+
+  vector<thread> pool;
+  for (int t = 1; t < threadCount; t++) {
+    pool.push_back(thread(work, t));
+  }
+  work(0);
+  for (size_t t = 0; t < pool.size(); t++) {
+    pool[t].join();
+  }
+
+  if (restoreCaller) {
+    pthread_setaffinity_np(pthread_self(), sizeof(callerCpus), &callerCpus);
+  }
+}
+
+/**
+ * @brief Prints the NUMA nodes the threads ran on, and how many tiles each
+ * thread traced.
+ *
+ */
+void TilePool::report(ostream &out) const {
+  int nodeCount = (int)nodes.size();
+  for (int t = 0; t < threadCount; t++) {
+    const Node &node = nodes[t % nodeCount];
+    out << "  Thread " << t << ": node " << node.id;
+    if (pin) {
+      out << ", CPU " << node.cpus[t / nodeCount % node.cpus.size()];
+    }
+    out << ", " << tilesPerThread[t] << " tiles\n";
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef H_TILE_POOL
+#define H_TILE_POOL
+
+#include "Distributed.h"
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief Traces the tiles of an image on several threads of this process.
+ *
+ * The threads are spread over the machine's NUMA nodes, and with pinning each
+ * is bound to one CPU of its node. Every node is given a contiguous run of the
+ * ordered tiles, so the tiles a node traces are close together in the image,
+ * and threads only take tiles from another node's run once their own is used
+ * up. Each thread allocates its tile buffer after it has been placed, so the
+ * buffer is first touched, and so allocated, on the thread's own node.
+ *
+ * Traced tiles are passed to the sink one at a time, in the order they finish.
+ */
+class TilePool {
+private:
+  struct Node {
+    int id;
+    std::vector<int> cpus; // The CPUs of the node this process may run on
+  };
+
+  int threadCount;
+  bool pin;
+  std::vector<Node> nodes;
+  std::vector<int> tilesPerThread;
+
+  void findNodes();
+
+public:
+  TilePool(int threads, bool pinThreads);
+
+  void render(const Camera &camera, int divisions, int samples,
+              const std::vector<Tile> &tiles, TileRenderer render,
+              TileSink *sink);
+
+  void report(std::ostream &out) const;
+};
+
+#endif //! H_TILE_POOL
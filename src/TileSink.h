@@ -0,0 +1,25 @@
+#ifndef H_TILE_SINK
+#define H_TILE_SINK
+
+#include "Tile.h"
+#include <glm/glm.hpp>
+
+/**
+ * @brief Receives the tiles of an image as they are traced, which may be in
+ * any order.
+ *
+ */
+class TileSink {
+public:
+  virtual ~TileSink() {}
+
+  /**
+   * @brief Takes the pixels of a traced tile.
+   *
+   * @param tile The tile's position and size.
+   * @param tilePixels The tile's pixels, stored row by row from the bottom row.
+   */
+  virtual void setTile(const Tile &tile, const glm::vec3 *tilePixels) = 0;
+};
+
+#endif //! H_TILE_SINK
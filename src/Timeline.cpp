@@ -0,0 +1,166 @@
+#include "Timeline.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+bool timelineEnabled = false;
+
+/**
+ * @brief One recorded zone, in nanoseconds since the timeline started.
+ *
+ */
+struct ZoneEvent {
+  const char *name;
+  uint64_t start;
+  uint64_t end;
+};
+
+/**
+ * @brief The zones recorded by one thread. Only the thread itself writes to
+ * its ring, and once it is full the oldest zones are overwritten.
+ *
+ */
+struct ThreadEvents {
+  int id;
+  string name;
+  vector<ZoneEvent> ring;
+  size_t recorded; // Zones recorded in total, including overwritten ones
+};
+
+static size_t ringSize = 0;
+static chrono::steady_clock::time_point origin;
+
+// Every thread's events, kept after the thread exits so they can be written
+static mutex registryMutex;
+static vector<ThreadEvents *> registry;
+static thread_local ThreadEvents *threadEvents = NULL;
+
+/**
+ * @brief Gets the calling thread's events, registering the thread on its
+ * first call.
+ *
+ * @return ThreadEvents*
+ */
+static ThreadEvents *eventsOfThisThread() {
+  if (threadEvents == NULL) {
+    threadEvents = new ThreadEvents;
+    threadEvents->ring.resize(ringSize);
+    threadEvents->recorded = 0;
+
+    lock_guard<mutex> lock(registryMutex);
+    threadEvents->id = (int)registry.size();
+    threadEvents->name = "Thread " + to_string(threadEvents->id);
+    registry.push_back(threadEvents);
+  }
+  return threadEvents;
+}
+
+/**
+ * @brief Starts recording zones. Must be called before any thread other than
+ * the main thread is started.
+ *
+ * @param eventsPerThread The number of zones each thread keeps. Once a thread
+ * has recorded more, its oldest zones are dropped.
+ */
+void startTimeline(size_t eventsPerThread) {
+  ringSize = eventsPerThread;
+  origin = chrono::steady_clock::now();
+  timelineEnabled = true;
+}
+
+/**
+ * @brief Names the calling thread in the exported timeline. Does nothing if
+ * the timeline is disabled.
+ *
+ * @param name
+ */
+void nameTimelineThread(const char *name) {
+  if (timelineEnabled) {
+    eventsOfThisThread()->name = name;
+  }
+}
+
+/**
+ * @brief The time since the timeline started, in nanoseconds.
+ *
+ * @return uint64_t
+ */
+uint64_t timelineNow() {
+  return chrono::duration_cast<chrono::nanoseconds>(
+             chrono::steady_clock::now() - origin)
+      .count();
+}
+
+/**
+ * @brief Records a zone on the calling thread's timeline.
+ *
+ * @param name
+ * @param start
+ * @param end
+ */
+void recordZone(const char *name, uint64_t start, uint64_t end) {
+  ThreadEvents *events = eventsOfThisThread();
+  ZoneEvent &event = events->ring[events->recorded % ringSize];
+  event.name = name;
+  event.start = start;
+  event.end = end;
+  events->recorded++;
+}
+
+/**
+ * @brief Writes every thread's zones as Chrome trace events, which can be
+ * opened in chrome://tracing or Perfetto. Threads which recorded zones must
+ * have finished or be idle.
+ *
+ * @param filename
+ * @return true The timeline was written.
+ * @return false The file could not be written.
+ */
+bool writeTimeline(const char *filename) {
+  FILE *file = fopen(filename, "w");
+  if (file == NULL) {
+    cerr << "*** Error opening timeline file: " << filename << endl;
+    return false;
+  }
+
+  lock_guard<mutex> lock(registryMutex);
+  int pid = getpid();
+  size_t dropped = 0;
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (size_t t = 0; t < registry.size(); t++) {
+    const ThreadEvents &events = *registry[t];
+    fprintf(file,
+            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"name\":\"%s\"}}",
+            t == 0 ? "" : ",\n", pid, events.id, events.name.c_str());
+
+    size_t kept = min(events.recorded, ringSize);
+    dropped += events.recorded - kept;
+    for (size_t i = events.recorded - kept; i < events.recorded; i++) {
+      const ZoneEvent &event = events.ring[i % ringSize];
+      fprintf(file,
+              ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+              "\"ts\":%.3f,\"dur\":%.3f}",
+              event.name, pid, events.id, event.start / 1000.0,
+              (event.end - event.start) / 1000.0);
+    }
+  }
+  fprintf(file, "\n]}\n");
+
+  bool written = !ferror(file);
+  written = fclose(file) == 0 && written;
+  if (!written) {
+    cerr << "*** Error writing timeline file: " << filename << endl;
+  } else if (dropped > 0) {
+    cerr << "Timeline: " << dropped << " of the oldest zones were dropped"
+         << endl;
+  }
+  return written;
+}
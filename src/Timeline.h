@@ -0,0 +1,57 @@
+#ifndef H_TIMELINE
+#define H_TIMELINE
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Whether zones are being recorded. Set once by `startTimeline()`,
+ * before any other thread is started.
+ *
+ */
+extern bool timelineEnabled;
+
+void startTimeline(size_t eventsPerThread);
+
+void nameTimelineThread(const char *name);
+
+uint64_t timelineNow();
+
+void recordZone(const char *name, uint64_t start, uint64_t end);
+
+bool writeTimeline(const char *filename);
+
+/**
+ * @brief Records how long the enclosing scope took, as one event on the
+ * calling thread's timeline. `name` must outlive the program's run, such as a
+ * string literal.
+ *
+ * Each thread records into a ring buffer of its own, so recording never takes
+ * a lock once the thread's first zone has been recorded. When the timeline is
+ * disabled, a zone costs a single test of `timelineEnabled`.
+ */
+class TimelineZone {
+private:
+  const char *name;
+  uint64_t start;
+  bool active;
+
+public:
+  explicit TimelineZone(const char *zoneName)
+      : name(zoneName), start(0), active(timelineEnabled) {
+    if (active) {
+      start = timelineNow();
+    }
+  }
+
+  ~TimelineZone() {
+    if (active) {
+      recordZone(name, start, timelineNow());
+    }
+  }
+
+  TimelineZone(const TimelineZone &) = delete;
+  TimelineZone &operator=(const TimelineZone &) = delete;
+};
+
+#endif //! H_TIMELINE
@@ -45,3 +45,11 @@ glm::vec3 Triangle::normal(glm::vec3 pt) {
   glm::vec3 n = glm::normalize(glm::cross(b - a, c - a));
   return n;
 }
+
+AABB Triangle::bounds() {
+  AABB box;
+  box.expand(a);
+  box.expand(b);
+  box.expand(c);
+  return box;
+}
@@ -21,6 +21,8 @@ public:
   float intersect(glm::vec3 posn, glm::vec3 dir);
 
   glm::vec3 normal(glm::vec3 pt);
+
+  AABB bounds();
 };
 
 #endif //! H_TRIANGLE
@@ -0,0 +1,110 @@
+#include "Views.h"
+#include <math.h>
+#include <string.h>
+
+using namespace std;
+
+// The names of the sets, as given on the command line
+static const char *const VIEW_SET_NAMES[] = {"single", "stereo", "cubemap",
+                                             "array"};
+
+// The cubemap faces, named after the axis each one looks along
+static const char *const FACE_NAMES[] = {"px", "nx", "py", "ny", "pz", "nz"};
+static const float FACE_YAWS[] = {M_PI / 2, -M_PI / 2, 0, 0, M_PI, 0};
+static const float FACE_PITCHES[] = {0, 0, M_PI / 2, -M_PI / 2, 0, 0};
+
+/**
+ * @brief Makes the cameras of a set of views.
+ *
+ * @param set
+ * @param center The camera the views are placed around.
+ * @param count The number of cameras in an array.
+ * @param spacing The distance between the eyes of a stereo pair, or between
+ * neighbouring cameras of an array, in world units.
+ * @return std::vector<View>
+ */
+vector<View> makeViews(ViewSet set, const Camera &center, int count,
+                       float spacing) {
+  vector<View> views;
+  View view = {"", center};
+  switch (set) {
+    case VIEWS_SINGLE:
+      views.push_back(view);
+      break;
+    case VIEWS_STEREO:
+      view.name = "left";
+      view.camera.move(0, -spacing / 2, 0);
+      views.push_back(view);
+      view.name = "right";
+      view.camera = center;
+      view.camera.move(0, spacing / 2, 0);
+      views.push_back(view);
+      break;
+    case VIEWS_CUBEMAP:
+      // A square image plane twice as wide as it is far from the eye spans
+      // 90 degrees
+      for (int face = 0; face < 6; face++) {
+        view.name = FACE_NAMES[face];
+        view.camera = Camera(center.eye, 2 * center.edist, 2 * center.edist,
+                             center.edist);
+        view.camera.orient(FACE_YAWS[face], FACE_PITCHES[face]);
+        views.push_back(view);
+      }
+      break;
+    case VIEWS_ARRAY:
+      for (int i = 0; i < count; i++) {
+        view.name = to_string(i);
+        view.camera = center;
+        view.camera.move(0, (i - (count - 1) * 0.5f) * spacing, 0);
+        views.push_back(view);
+      }
+      break;
+  }
+  return views;
+}
+
+/**
+ * @brief Names the image of a view after the output file, with the view's name
+ * added before the extension: "out.ppm" becomes "out-left.ppm".
+ *
+ * @param output
+ * @param name
+ * @return std::string
+ */
+string viewFileName(const string &output, const string &name) {
+  if (name.empty()) {
+    return output;
+  }
+  size_t dot = output.rfind('.');
+  size_t slash = output.rfind('/');
+  if (dot == string::npos || (slash != string::npos && dot < slash)) {
+    return output + "-" + name;
+  }
+  return output.substr(0, dot) + "-" + name + output.substr(dot);
+}
+
+/**
+ * @brief The name of a set of views, as given on the command line.
+ *
+ * @param set
+ * @return const char*
+ */
+const char *viewSetName(ViewSet set) { return VIEW_SET_NAMES[set]; }
+
+/**
+ * @brief Parses the name of a set of views.
+ *
+ * @param name
+ * @param set Receives the set.
+ * @return true The name is known.
+ * @return false The name is not known.
+ */
+bool parseViewSet(const char *name, ViewSet *set) {
+  for (int i = VIEWS_SINGLE; i <= VIEWS_ARRAY; i++) {
+    if (strcmp(name, VIEW_SET_NAMES[i]) == 0) {
+      *set = (ViewSet)i;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,37 @@
+#ifndef H_VIEWS
+#define H_VIEWS
+
+#include "Camera.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief The sets of views a headless render can trace of the same scene.
+ *
+ * `VIEWS_SINGLE` is the camera alone. `VIEWS_STEREO` is a left and a right
+ * eye, either side of the camera. `VIEWS_CUBEMAP` is the six faces of a
+ * cubemap around the camera's eye, each with a 90 degree field of view.
+ * `VIEWS_ARRAY` is a row of cameras, centred on the camera and spread along
+ * its right vector.
+ */
+enum ViewSet { VIEWS_SINGLE, VIEWS_STEREO, VIEWS_CUBEMAP, VIEWS_ARRAY };
+
+/**
+ * @brief One of the views of a set, and the name its image is written under.
+ *
+ */
+struct View {
+  std::string name;
+  Camera camera;
+};
+
+std::vector<View> makeViews(ViewSet set, const Camera &center, int count,
+                            float spacing);
+
+std::string viewFileName(const std::string &output, const std::string &name);
+
+const char *viewSetName(ViewSet set);
+
+bool parseViewSet(const char *name, ViewSet *set);
+
+#endif //! H_VIEWS
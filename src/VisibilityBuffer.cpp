@@ -0,0 +1,191 @@
+#include "VisibilityBuffer.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+// How far object boxes are grown before being projected, to cover rounding in
+// the intersection tests
+const float PROJECTION_MARGIN = 1e-3;
+
+/**
+ * @brief A range of cells, inclusive on both ends.
+ *
+ */
+struct CellRect {
+  int x0, y0, x1, y1;
+};
+
+/**
+ * @brief Finds the cell containing a coordinate on the image plane. Points far
+ * outside the image are clamped to just outside it, so the cast cannot
+ * overflow.
+ *
+ * @param coord The coordinate along one axis of the image plane.
+ * @param start Where the first cell starts along the axis.
+ * @param size The size of a cell along the axis.
+ * @param cells The number of cells along the axis.
+ * @return int
+ */
+static int cellOf(float coord, float start, float size, int cells) {
+  float cell = floorf((coord - start) / size);
+  return (int)fmaxf(-2, fminf(cell, cells + 1));
+}
+
+/**
+ * @brief Finds the cells whose primary rays could hit anything inside a box.
+ *
+ * @param camera
+ * @param cells The number of cells along x and y.
+ * @param box
+ * @param rect Receives the range of cells.
+ * @return true The box may be visible, and `rect` is set.
+ * @return false The box is entirely behind the eye.
+ */
+static bool projectBox(const Camera &camera, int cells, const AABB &box,
+                       CellRect *rect) {
+  float xlo = INFINITY, xhi = -INFINITY;
+  float ylo = INFINITY, yhi = -INFINITY;
+  int inFront = 0;
+  for (int corner = 0; corner < 8; corner++) {
+    glm::vec3 p(corner & 1 ? box.hi.x : box.lo.x,
+                corner & 2 ? box.hi.y : box.lo.y,
+                corner & 4 ? box.hi.z : box.lo.z);
+    float x, y;
+    if (camera.project(p, &x, &y)) {
+      inFront++;
+      xlo = min(xlo, x);
+      xhi = max(xhi, x);
+      ylo = min(ylo, y);
+      yhi = max(yhi, y);
+    }
+  }
+
+  if (inFront == 0) {
+    return false;
+  }
+  if (inFront < 8) {
+    // The box reaches behind the eye, so its projection is unbounded
+    *rect = {0, 0, cells - 1, cells - 1};
+    return true;
+  }
+
+  // Anti-aliasing samples sit up to a quarter of a cell outside their own
+  // cell, so one extra cell is covered on every side
+  float cellX = camera.width / cells;
+  float cellY = camera.height / cells;
+  rect->x0 = max(0, cellOf(xlo, camera.xmin(), cellX, cells) - 1);
+  rect->x1 = min(cells - 1, cellOf(xhi, camera.xmin(), cellX, cells) + 1);
+  rect->y0 = max(0, cellOf(ylo, camera.ymin(), cellY, cells) - 1);
+  rect->y1 = min(cells - 1, cellOf(yhi, camera.ymin(), cellY, cells) + 1);
+  return rect->x0 <= rect->x1 && rect->y0 <= rect->y1;
+}
+
+/**
+ * @brief Builds the candidate lists of every cell, for primary rays from
+ * `camera` through a `cells` x `cells` grid.
+ *
+ * @param camera
+ * @param cells
+ * @param objects The scene objects, which later searches must be given too.
+ */
+void VisibilityBuffer::build(const Camera &camera, int cells,
+                             const vector<SceneObject *> &objects) {
+  view = camera;
+  divisions = cells;
+  objectCount = objects.size();
+
+  vector<CellRect> rects(objects.size());
+  vector<bool> visible(objects.size());
+  offsets.assign(cells * cells + 1, 0);
+
+  // Count the candidates of each cell, then lay the lists out one after
+  // another
+  for (size_t i = 0; i < objects.size(); i++) {
+    AABB box = objects[i]->bounds();
+    box.pad(PROJECTION_MARGIN);
+    visible[i] = projectBox(camera, cells, box, &rects[i]);
+    if (!visible[i]) {
+      continue;
+    }
+    for (int y = rects[i].y0; y <= rects[i].y1; y++) {
+      for (int x = rects[i].x0; x <= rects[i].x1; x++) {
+        offsets[y * cells + x + 1]++;
+      }
+    }
+  }
+  for (int c = 0; c < cells * cells; c++) {
+    offsets[c + 1] += offsets[c];
+  }
+
+  // Objects are added in scene order, so each list is sorted
+  candidates.resize(offsets[cells * cells]);
+  vector<int> next(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < objects.size(); i++) {
+    if (!visible[i]) {
+      continue;
+    }
+    for (int y = rects[i].y0; y <= rects[i].y1; y++) {
+      for (int x = rects[i].x0; x <= rects[i].x1; x++) {
+        candidates[next[y * cells + x]++] = i;
+      }
+    }
+  }
+  valid = true;
+}
+
+/**
+ * @brief Checks whether the lists can be used for primary rays from `camera`
+ * through a `cells` x `cells` grid.
+ *
+ * @param camera
+ * @param cells
+ * @param objects
+ * @return true
+ * @return false The buffer must be rebuilt first.
+ */
+bool VisibilityBuffer::isBuiltFor(const Camera &camera, int cells,
+                                  const vector<SceneObject *> &objects) const {
+  return valid && divisions == cells && objectCount == objects.size() &&
+         view.sameView(camera);
+}
+
+/**
+ * @brief Finds the closest intersection of a primary ray with the objects
+ * listed for its cell.
+ *
+ * @param ray A primary ray through cell (x, y).
+ * @param x
+ * @param y
+ * @param objects The scene objects the buffer was built from.
+ * @return Hit
+ */
+Hit VisibilityBuffer::closestHit(const Ray &ray, int x, int y,
+                                 const vector<SceneObject *> &objects) const {
+  Hit hit;
+  hit.t = ray.tmax;
+  int cell = y * divisions + x;
+  for (int k = offsets[cell]; k < offsets[cell + 1]; k++) {
+    int i = candidates[k];
+    int part;
+    float t = objects[i]->intersectPart(ray.pt, ray.dir, &part);
+    if (t > ray.tmin && t < hit.t) {
+      hit.t = t;
+      hit.index = i;
+      hit.part = part;
+    }
+  }
+  return hit;
+}
+
+/**
+ * @brief Returns the mean number of objects listed per cell.
+ *
+ * @return float
+ */
+float VisibilityBuffer::averageCandidates() const {
+  if (divisions == 0) {
+    return 0;
+  }
+  return (float)candidates.size() / (divisions * divisions);
+}
@@ -0,0 +1,53 @@
+#ifndef H_VISIBILITY_BUFFER
+#define H_VISIBILITY_BUFFER
+
+#include "Camera.h"
+#include "Ray.h"
+#include "SceneObject.h"
+#include <vector>
+
+/**
+ * @brief Lists, for every cell of the image, the objects which a primary ray
+ * through that cell could hit. It is built by projecting each object's box
+ * onto the image plane, so primary rays only need to test the few objects
+ * covering their cell rather than the whole scene.
+ *
+ * The lists are conservative and keep the scene's order, so a search over a
+ * cell's list finds exactly the hit a search over the whole scene would.
+ *
+ */
+class VisibilityBuffer {
+private:
+  Camera view;
+  int divisions;
+  size_t objectCount;
+  bool valid;
+
+  // The candidates of cell (x, y) are candidates[offsets[c]] up to
+  // candidates[offsets[c + 1]], where c = y * divisions + x
+  std::vector<int> offsets;
+  std::vector<int> candidates;
+
+public:
+  VisibilityBuffer() : divisions(0), objectCount(0), valid(false) {}
+
+  void build(const Camera &camera, int cells,
+             const std::vector<SceneObject *> &objects);
+
+  bool isBuiltFor(const Camera &camera, int cells,
+                  const std::vector<SceneObject *> &objects) const;
+
+  /**
+   * @brief Forgets the lists, so that they are rebuilt before next use. Must
+   * be called whenever the scene changes.
+   *
+   */
+  void invalidate() { valid = false; }
+
+  Hit closestHit(const Ray &ray, int x, int y,
+                 const std::vector<SceneObject *> &objects) const;
+
+  float averageCandidates() const;
+};
+
+#endif //! H_VISIBILITY_BUFFER
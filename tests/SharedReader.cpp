@@ -0,0 +1,251 @@
+// Reads a framebuffer published with --shared the way another process would,
+// and checks it.
+//
+// Usage: shared-reader NAME [IMAGE]
+//
+// Waits for the shared memory object NAME and a completed frame, checking the
+// header and that the sequence only ever moves on, and is even whenever a
+// snapshot is kept. With IMAGE, the PPM the renderer wrote, the frame's pixels
+// must match it exactly, and no write may still be under way.
+
+#include "../src/SharedFramebuffer.h"
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// How long to wait for the renderer to create the object and finish a frame
+const chrono::seconds TIMEOUT(10);
+
+/**
+ * @brief A consistent copy of the shared framebuffer.
+ *
+ */
+struct Snapshot {
+  uint64_t sequence;
+  uint64_t frames;
+  uint64_t tiles;
+  uint32_t width;
+  uint32_t height;
+  vector<unsigned char> pixels;
+};
+
+/**
+ * @brief Opens and maps the shared memory object once the renderer has created
+ * it and written its header.
+ *
+ * @param name
+ * @param bytes Receives the size of the mapping.
+ * @return const SharedFrameHeader* The header, or NULL after the timeout.
+ */
+const SharedFrameHeader *mapShared(const char *name, size_t *bytes) {
+  chrono::steady_clock::time_point giveUp =
+      chrono::steady_clock::now() + TIMEOUT;
+  const SharedFrameHeader *header = NULL;
+  while (chrono::steady_clock::now() < giveUp) {
+    if (header == NULL) {
+      int fd = shm_open(name, O_RDONLY, 0);
+      struct stat info;
+      if (fd >= 0 && fstat(fd, &info) == 0 &&
+          (size_t)info.st_size >= sizeof(SharedFrameHeader)) {
+        void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED) {
+          header = (const SharedFrameHeader *)mapped;
+          *bytes = info.st_size;
+        }
+      }
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+
+    // The magic number is written last, once the rest of the header is ready
+    if (header != NULL &&
+        *(const volatile uint32_t *)&header->magic != 0) {
+      atomic_thread_fence(memory_order_acquire);
+      return header;
+    }
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  cerr << "Timed out waiting for shared memory " << name << endl;
+  return NULL;
+}
+
+/**
+ * @brief Checks the fixed fields of the header.
+ *
+ * @param header
+ * @param bytes The size of the mapping.
+ * @return true The header describes the mapping.
+ * @return false
+ */
+bool checkHeader(const SharedFrameHeader *header, size_t bytes) {
+  if (header->magic != SHARED_FRAME_MAGIC) {
+    cerr << "Wrong magic number " << hex << header->magic << dec << endl;
+    return false;
+  }
+  if (header->version != SHARED_FRAME_VERSION) {
+    cerr << "Unknown version " << header->version << endl;
+    return false;
+  }
+  if (header->format != SHARED_RGB8) {
+    cerr << "Unknown pixel format " << header->format << endl;
+    return false;
+  }
+  if (header->dataOffset < sizeof(SharedFrameHeader) ||
+      header->dataOffset + (size_t)header->capacityWidth *
+                               header->capacityHeight * 3 >
+          bytes) {
+    cerr << "Pixels at " << header->dataOffset << " for "
+         << header->capacityWidth << " x " << header->capacityHeight
+         << " do not fit in " << bytes << " bytes" << endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Copies the framebuffer under the seqlock, retrying while a write is
+ * under way or one happened during the copy.
+ *
+ * @param header
+ * @param snapshot Receives the copy.
+ * @return int The number of attempts which found a write under way.
+ */
+int readSnapshot(const SharedFrameHeader *header, Snapshot *snapshot) {
+  const unsigned char *data =
+      (const unsigned char *)header + header->dataOffset;
+  int busy = 0;
+  while (true) {
+    uint64_t before = header->sequence.load(memory_order_acquire);
+    if (before % 2 != 0) {
+      busy++;
+      continue;
+    }
+    snapshot->width = header->width.load(memory_order_relaxed);
+    snapshot->height = header->height.load(memory_order_relaxed);
+    snapshot->frames = header->frames.load(memory_order_relaxed);
+    snapshot->tiles = header->tiles.load(memory_order_relaxed);
+    size_t size = (size_t)snapshot->width * snapshot->height * 3;
+    if (snapshot->width <= header->capacityWidth &&
+        snapshot->height <= header->capacityHeight) {
+      snapshot->pixels.assign(data, data + size);
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (header->sequence.load(memory_order_relaxed) == before) {
+      snapshot->sequence = before;
+      return busy;
+    }
+    busy++;
+  }
+}
+
+/**
+ * @brief Reads a binary PPM image as written by `Framebuffer::writePPM`.
+ *
+ * @param filename
+ * @param width
+ * @param height
+ * @param pixels Receives the pixels, top row first.
+ * @return true The image was read.
+ * @return false
+ */
+bool readPPM(const char *filename, uint32_t *width, uint32_t *height,
+             vector<unsigned char> *pixels) {
+  ifstream file(filename, ios::in | ios::binary);
+  string magic;
+  int maxValue;
+  file >> magic >> *width >> *height >> maxValue;
+  file.get();
+  if (!file || magic != "P6" || maxValue != 255) {
+    cerr << "Could not read " << filename << endl;
+    return false;
+  }
+  pixels->resize((size_t)*width * *height * 3);
+  file.read((char *)pixels->data(), pixels->size());
+  if (!file) {
+    cerr << filename << " is too short" << endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " NAME [IMAGE]" << endl;
+    return 2;
+  }
+  size_t bytes = 0;
+  const SharedFrameHeader *header = mapShared(argv[1], &bytes);
+  if (header == NULL || !checkHeader(header, bytes)) {
+    return 1;
+  }
+
+  // Follow the renderer until it completes a frame
+  chrono::steady_clock::time_point giveUp =
+      chrono::steady_clock::now() + TIMEOUT;
+  Snapshot last = {0, 0, 0, 0, 0, vector<unsigned char>()};
+  Snapshot snapshot;
+  int snapshots = 0;
+  int busy = 0;
+  do {
+    busy += readSnapshot(header, &snapshot);
+    snapshots++;
+    if (snapshot.sequence < last.sequence || snapshot.frames < last.frames ||
+        snapshot.tiles < last.tiles) {
+      cerr << "The sequence went back from " << last.sequence << " to "
+           << snapshot.sequence << endl;
+      return 1;
+    }
+    if (snapshot.width > header->capacityWidth ||
+        snapshot.height > header->capacityHeight) {
+      cerr << "Frame of " << snapshot.width << " x " << snapshot.height
+           << " is over the capacity" << endl;
+      return 1;
+    }
+    last = snapshot;
+    if (chrono::steady_clock::now() > giveUp) {
+      cerr << "Timed out waiting for a frame" << endl;
+      return 1;
+    }
+  } while (snapshot.frames == 0);
+  cout << "Shared " << snapshot.width << " x " << snapshot.height
+       << " frame after " << snapshot.tiles << " tiles, " << snapshots
+       << " snapshots, " << busy << " reads during a write" << endl;
+
+  if (argc < 3) {
+    return 0;
+  }
+  uint32_t width, height;
+  vector<unsigned char> pixels;
+  if (!readPPM(argv[2], &width, &height, &pixels)) {
+    return 1;
+  }
+  if (header->sequence.load(memory_order_acquire) % 2 != 0) {
+    cerr << "A write is still under way after the image was written" << endl;
+    return 1;
+  }
+  if (width != snapshot.width || height != snapshot.height) {
+    cerr << "The image is " << width << " x " << height << ", the frame "
+         << snapshot.width << " x " << snapshot.height << endl;
+    return 1;
+  }
+  for (size_t i = 0; i < pixels.size(); i++) {
+    if (pixels[i] != snapshot.pixels[i]) {
+      size_t pixel = i / 3;
+      cerr << "Pixel " << pixel % width << ", " << pixel / width
+           << " differs from " << argv[2] << endl;
+      return 1;
+    }
+  }
+  cout << "Frame matches " << argv[2] << endl;
+  return 0;
+}
@@ -0,0 +1,105 @@
+#!/bin/bash
+# Renders the reference scenes listed in tests/scenes.txt, and checks them
+# against the golden images in tests/golden and the timings in
+# tests/baselines.txt.
+#
+# Usage: tests/regression.sh PROGRAM [--images | --performance | --update]
+#
+#   --images       only compare the images (the default checks both)
+#   --performance  only compare the timings
+#   --update       render new golden images and record new baselines
+#
+# PERF_RUNS is how many times each scene is timed (default 5). The baseline is
+# the median of the runs, and a check passes if the fastest run is no more than
+# PERF_MARGIN percent slower than the baseline (default 25), so that a single
+# slow run on a busy machine does not fail the check. Renders and, for failed
+# images, error heatmaps are left in tests/output.
+
+if [ $# -lt 1 ]; then
+  sed -n '6,16p' "$0" | sed 's/^# \{0,1\}//'
+  exit 2
+fi
+
+program=$(realpath "$1")
+mode=${2:-all}
+margin=${PERF_MARGIN:-25}
+runs=${PERF_RUNS:-5}
+
+cd "$(dirname "$0")/.."
+mkdir -p tests/output
+baselines=tests/baselines.txt
+failures=0
+
+# Prints field $2 of the first line of the report starting with $1
+field() {
+  grep "^$1" | head -n 1 | awk '{print $'"$2"'}'
+}
+
+if [ "$mode" = "--update" ]; then
+  echo "# name  frame_ms  primary_rays_per_second (median of $runs runs)" \
+    > $baselines
+fi
+
+while read -r name tolerance options; do
+  case "$name" in
+    '' | '#'*) continue ;;
+  esac
+  golden=tests/golden/$name.ppm
+  output=tests/output/$name.ppm
+
+  if [ "$mode" = "--update" ]; then
+    $program --output "$golden" $options > /dev/null || exit 1
+  fi
+
+  if [ "$mode" = "all" ] || [ "$mode" = "--images" ]; then
+    if $program --output "$output" $options --reference "$golden" \
+      --tolerance "$tolerance" --heatmap "tests/output/$name-heatmap.ppm" \
+      > "tests/output/$name.log" 2>&1; then
+      difference=$(field Difference 5 < "tests/output/$name.log" | tr -d ,)
+      echo "PASS image  $name: max difference $difference" \
+        "(tolerance $tolerance)"
+    else
+      echo "FAIL image  $name:"
+      sed 's/^/    /' "tests/output/$name.log" | grep -v "^    \(  \|Scene\)"
+      failures=$((failures + 1))
+    fi
+  fi
+
+  if [ "$mode" = "all" ] || [ "$mode" = "--performance" ] ||
+    [ "$mode" = "--update" ]; then
+    # Each run's time and rays per second, fastest first
+    times=$(for run in $(seq "$runs"); do
+      report=$($program --output "$output" $options 2>&1)
+      echo "$(echo "$report" | field Rendered 3)" \
+        "$(echo "$report" | field Primary 3)"
+    done | sort -g)
+    best=$(echo "$times" | head -n 1 | awk '{print $1}')
+    rays=$(echo "$times" | head -n 1 | awk '{print $2}')
+
+    if [ "$mode" = "--update" ]; then
+      median=$(echo "$times" | sed -n "$(((runs + 1) / 2))p")
+      echo "$name $median" >> $baselines
+      echo "Recorded $name: $median" | awk '{print $1, $2, $3 " ms,", $4,
+        "primary rays per second"}'
+      continue
+    fi
+
+    baseline=$(awk -v name="$name" '$1 == name {print $2}' $baselines)
+    if [ -z "$baseline" ]; then
+      echo "FAIL time   $name: no baseline in $baselines"
+      failures=$((failures + 1))
+    elif awk "BEGIN { exit !($best > $baseline * (1 + $margin / 100)) }"; then
+      echo "FAIL time   $name: fastest $best ms, baseline $baseline ms" \
+        "(more than $margin% slower)"
+      failures=$((failures + 1))
+    else
+      echo "PASS time   $name: fastest $best ms, baseline $baseline ms," \
+        "$rays primary rays per second"
+    fi
+  fi
+done < tests/scenes.txt
+
+if [ $failures -gt 0 ]; then
+  echo "$failures checks failed"
+  exit 1
+fi
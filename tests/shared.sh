@@ -0,0 +1,33 @@
+#!/bin/bash
+# Checks the reader side of --shared: a reader follows a render as it is
+# published, then maps the object the renderer left behind and compares its
+# frame with the image the renderer wrote.
+#
+# Usage: tests/shared.sh PROGRAM READER
+#
+# READER is the shared-reader tool built from tests/SharedReader.cpp.
+
+if [ $# -lt 2 ]; then
+  sed -n '6,8p' "$0" | sed 's/^# \{0,1\}//'
+  exit 2
+fi
+
+program=$(realpath "$1")
+reader=$(realpath "$2")
+name=/raytracer-test-$$
+image=tests/output/shared.ppm
+
+cd "$(dirname "$0")/.."
+mkdir -p tests/output
+trap 'rm -f /dev/shm$name' EXIT
+
+# Small tiles, so that the reader sees many writes while the frame is traced
+$program --output $image --shared $name --size 100 --tile 4 \
+  > /dev/null &
+renderer=$!
+$reader $name
+following=$?
+wait $renderer || exit 1
+[ $following -eq 0 ] || exit 1
+
+$reader $name $image
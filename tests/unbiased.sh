@@ -0,0 +1,52 @@
+#!/bin/bash
+# Checks that Russian roulette keeps renders unbiased: the mean of a render
+# with --roulette must match, within MAX_BIAS, that of a render which traces
+# every ray, while cutting the same rays off without roulette must not.
+#
+# Usage: tests/unbiased.sh PROGRAM
+#
+# The bias is the mean difference per channel, in 8 bit levels. MAX_BIAS
+# defaults to 0.1, and cut-off renders must be biased by more than 1.
+
+if [ $# -lt 1 ]; then
+  sed -n '6,9p' "$0" | sed 's/^# \{0,1\}//'
+  exit 2
+fi
+
+program=$(realpath "$1")
+max_bias=${MAX_BIAS:-0.1}
+options="--size 100 --samples 64"
+threshold="--min-contribution 0.6"
+
+cd "$(dirname "$0")/.."
+mkdir -p tests/output
+reference=tests/output/unbiased-reference.ppm
+$program --output $reference $options > /dev/null || exit 1
+
+# Prints the bias of a render from the reference
+bias() {
+  $program --output tests/output/unbiased.ppm $options "$@" \
+    --reference $reference | grep "^Difference" | awk '{print $9}' | tr -d ,
+}
+
+roulette=$(bias $threshold --roulette)
+cutoff=$(bias $threshold)
+failures=0
+
+if awk "BEGIN { b = $roulette; exit !(b <= $max_bias && b >= -$max_bias) }"
+then
+  echo "PASS roulette: bias $roulette (at most $max_bias)"
+else
+  echo "FAIL roulette: bias $roulette (at most $max_bias)"
+  failures=$((failures + 1))
+fi
+
+# Without roulette the cut-off rays are simply lost, so the check must see it
+if awk "BEGIN { b = $cutoff; exit !(b > 1 || b < -1) }"; then
+  echo "PASS cut-off: bias $cutoff (more than 1, as expected)"
+else
+  echo "FAIL cut-off: bias $cutoff (expected more than 1)"
+  failures=$((failures + 1))
+fi
+
+exit $((failures > 0))